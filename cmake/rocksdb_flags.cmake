@@ -44,6 +44,18 @@ if (WITH_ZSTD)
   include_directories(${ZSTD_INCLUDE_DIR})
 endif()
 
+option(WITH_LIBURING "build with liburing" OFF)
+if (WITH_LIBURING)
+  find_path(LIBURING_INCLUDE_DIR NAMES liburing.h)
+  find_library(LIBURING_LIBRARIES NAMES uring)
+  if (NOT LIBURING_INCLUDE_DIR OR NOT LIBURING_LIBRARIES)
+    message(FATAL_ERROR "WITH_LIBURING=ON but liburing is not found")
+  endif()
+  add_definitions(-DTITAN_IOURING_PRESENT)
+  include_directories(${LIBURING_INCLUDE_DIR})
+  link_libraries(${LIBURING_LIBRARIES})
+endif()
+
 if(MSVC)
   set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} /Zi /nologo /EHsc /GS /Gd /GR /GF /fp:precise /Zc:wchar_t /Zc:forScope /errorReport:queue")
   set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} /FC /d2Zi+ /W4 /wd4127 /wd4800 /wd4996 /wd4351 /wd4100 /wd4204 /wd4324")
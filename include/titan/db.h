@@ -15,6 +15,22 @@ struct TitanCFDescriptor {
       : name(_name), options(_options) {}
 };
 
+// The iterators created by TitanDB are TitanIterators.
+class TitanIterator : public Iterator {
+ public:
+  // Returns true if value() can return the value of the current entry
+  // without reading blob files. It is false only for a blob entry whose
+  // value is read lazily, see TitanReadOptions::lazy_value, until it is
+  // read. If it isn't, value() reads it and status() must be checked
+  // afterwards, as a failed read returns an empty value.
+  virtual bool IsValueLoaded() const = 0;
+
+  // Hints that value() is going to be called for the current entry.
+  // Starts reading a lazily read value in the background, or has the OS
+  // read it if there are no blob read threads. Does nothing otherwise.
+  virtual void PrefetchValue() = 0;
+};
+
 class TitanDB : public StackableDB {
  public:
   static Status Open(const TitanOptions& options, const std::string& dbname,
@@ -27,9 +43,18 @@ class TitanDB : public StackableDB {
 
   TitanDB() : StackableDB(nullptr) {}
 
-  virtual int Scan(const ReadOptions& options, const std::string& start_key,
-                   int len, std::vector<std::string>& keys,
+  // Reads up to "len" entries starting at "start_key" into "keys" and
+  // "vals", and returns the number read. The blob values are fetched by
+  // blob file, several files at a time, see
+  // TitanReadOptions::scan_fan_out.
+  virtual int Scan(const TitanReadOptions& options,
+                   const std::string& start_key, int len,
+                   std::vector<std::string>& keys,
                    std::vector<std::string>& vals) = 0;
+  int Scan(const ReadOptions& options, const std::string& start_key, int len,
+           std::vector<std::string>& keys, std::vector<std::string>& vals) {
+    return Scan(TitanReadOptions(options), start_key, len, keys, vals);
+  }
 
   using StackableDB::CreateColumnFamily;
   Status CreateColumnFamily(const ColumnFamilyOptions& options,
@@ -81,6 +106,71 @@ class TitanDB : public StackableDB {
   Status DestroyColumnFamilyHandle(ColumnFamilyHandle* column_family) override =
       0;
 
+  using StackableDB::Get;
+  Status Get(const ReadOptions& options, ColumnFamilyHandle* column_family,
+             const Slice& key, PinnableSlice* value) override {
+    return Get(TitanReadOptions(options), column_family, key, value);
+  }
+  virtual Status Get(const TitanReadOptions& options,
+                     ColumnFamilyHandle* column_family, const Slice& key,
+                     PinnableSlice* value) = 0;
+
+  // Gets up to "len" bytes of the value of "key" starting at "offset". The
+  // result is shorter if the value ends earlier and empty if it ends before
+  // "offset". Only the requested bytes of a blob value are read if it is
+  // stored uncompressed with a compact blob index, see
+  // TitanCFOptions::compact_blob_index, and its record is not in the blob
+  // cache already.
+  virtual Status GetPartial(const TitanReadOptions& options,
+                            ColumnFamilyHandle* column_family,
+                            const Slice& key, uint64_t offset, uint64_t len,
+                            PinnableSlice* value) = 0;
+  virtual Status GetPartial(const TitanReadOptions& options, const Slice& key,
+                            uint64_t offset, uint64_t len,
+                            PinnableSlice* value) {
+    return GetPartial(options, DefaultColumnFamily(), key, offset, len, value);
+  }
+
+  // Writes the value of "key" read from "source" until its end. The value
+  // is stored in chunks of TitanCFOptions::blob_chunk_size bytes, read
+  // from "source" and written out one at a time, so that values too large
+  // to be held in memory can be written. The chunks go into a blob file of
+  // their own, which is synced before the key is written.
+  virtual Status PutStream(const WriteOptions& options,
+                           ColumnFamilyHandle* column_family,
+                           const Slice& key, SequentialFile* source) = 0;
+  virtual Status PutStream(const WriteOptions& options, const Slice& key,
+                           SequentialFile* source) {
+    return PutStream(options, DefaultColumnFamily(), key, source);
+  }
+
+  // Opens the value of "key" to be read through "*result". A value stored
+  // in chunks, see PutStream, is read a chunk at a time as the stream is
+  // consumed, and only one chunk is held in memory; other values are read
+  // at once. The stream reads the value as of when it is opened, and must
+  // be destroyed before the DB is closed.
+  virtual Status GetStream(const TitanReadOptions& options,
+                           ColumnFamilyHandle* column_family,
+                           const Slice& key,
+                           std::unique_ptr<SequentialFile>* result) = 0;
+  virtual Status GetStream(const TitanReadOptions& options, const Slice& key,
+                           std::unique_ptr<SequentialFile>* result) {
+    return GetStream(options, DefaultColumnFamily(), key, result);
+  }
+
+  // Gets the size of the value of "key" without reading blob files. The
+  // size of a blob value is taken from its blob index. It is exact for a
+  // compact blob index, see TitanCFOptions::compact_blob_index; otherwise
+  // it is the size of the stored, possibly compressed, blob record without
+  // its header, which still counts the key.
+  virtual Status GetValueSize(const TitanReadOptions& options,
+                              ColumnFamilyHandle* column_family,
+                              const Slice& key, uint64_t* size) = 0;
+  virtual Status GetValueSize(const TitanReadOptions& options, const Slice& key,
+                              uint64_t* size) {
+    return GetValueSize(options, DefaultColumnFamily(), key, size);
+  }
+
   using StackableDB::NewIterator;
   Iterator* NewIterator(const ReadOptions& opts,
                         ColumnFamilyHandle* column_family) override {
@@ -177,6 +267,9 @@ class TitanDB : public StackableDB {
     //  "rocksdb.titandb.discardable_ratio_le100_file_num" - returns count of
     //  file whose discardable ratio is less or equal to 100%.
     static const std::string kNumDiscardableRatioLE100File;
+    //  "rocksdb.titandb.iterator.value-size" - an iterator property, returns
+    //  the size of the current value, see TitanReadOptions::value_size_only.
+    static const std::string kIteratorValueSize;
   };
 
   bool GetProperty(ColumnFamilyHandle* column_family, const Slice& property,
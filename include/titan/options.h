@@ -45,6 +45,93 @@ struct TitanDBOptions : public DBOptions {
   // block foreground write if blob size too large
   uint64_t block_write_size{0};
 
+  // Number of threads used to read blob files in parallel on behalf of a
+  // single foreground request, e.g. a MultiGet touching several blob files.
+  // If zero, blob files are read one by one in the calling thread.
+  //
+  // Default: 0
+  int32_t num_blob_read_threads{0};
+
+  // Maximum number of blob reads a thread keeps in flight through io_uring
+  // when serving a batch, e.g. MultiGet or Scan. Takes effect only if Titan
+  // is built with liburing (WITH_LIBURING). If zero, or io_uring cannot be
+  // set up, batched reads are issued one by one with pread.
+  //
+  // Default: 0
+  uint32_t blob_io_uring_queue_depth{0};
+
+  // If true, readers of all live blob files are opened while the DB is
+  // opened, using up to max_file_opening_threads threads, so that the first
+  // reads don't pay for opening files. The footer read is skipped for files
+  // whose size on disk matches the one recorded in the manifest.
+  //
+  // Default: false
+  bool preload_blob_file_readers{false};
+
+  // Maximum number of blob file readers kept open. If zero, max_open_files
+  // is used instead. A negative value means no practical limit.
+  //
+  // Default: 0
+  int max_open_blob_files{0};
+
+  // Number of shard bits of the blob file reader cache. If negative, it is
+  // derived from the cache capacity.
+  //
+  // Default: -1
+  int blob_file_cache_num_shard_bits{-1};
+
+  // If true, blob files are read with direct I/O even if use_direct_reads
+  // is not set, so that blob reads don't compete with SSTs for the page
+  // cache and blob_cache is the only cache of values. Direct blob reads
+  // are rounded to sector boundaries and go through pooled aligned
+  // buffers, and the last sectors of every opened file are kept in memory.
+  //
+  // Default: false
+  bool use_direct_blob_reads{false};
+
+  // Maximum bytes of idle aligned buffers kept for direct blob reads.
+  //
+  // Default: 4MB
+  uint64_t blob_direct_read_buffer_pool_size{4 << 20};
+
+  // If not empty, blob values read repeatedly are also kept in a cache
+  // file at this path, which is checked after blob_cache misses and
+  // before the blob file is read. The file stays valid across restarts,
+  // so it should be placed on a device faster than the one of the blob
+  // files. It is shared by all column families.
+  //
+  // Default: empty
+  std::string blob_flash_cache_path;
+
+  // Size of the file at blob_flash_cache_path.
+  //
+  // Default: 1GB
+  uint64_t blob_flash_cache_size{1ull << 30};
+
+  // If non-zero, the handles of the blob records read into the blob cache
+  // most recently are written to a file in dirname every this many
+  // seconds and when the DB is closed. On the next open they are loaded
+  // back into the blob cache in the background, most recent first, so
+  // that the cache doesn't start cold after a restart.
+  //
+  // Default: 0
+  uint32_t blob_cache_dump_period_sec{0};
+
+  // Limits the reads of loading the blob cache on open, see
+  // blob_cache_dump_period_sec. Zero means no limit.
+  //
+  // Default: 32MB
+  uint64_t blob_cache_warmup_bytes_per_sec{32 << 20};
+
+  // If non-null, values read by Get at the latest sequence are cached
+  // here by column family and user key, with blob indexes resolved, so
+  // that hot keys skip both the LSM and the blob files. Unlike row_cache,
+  // which caches the blob indexes, entries are invalidated by writes made
+  // through Titan.
+  //
+  // Default: nullptr
+  std::shared_ptr<Cache> titan_row_cache;
+
   TitanDBOptions() = default;
   explicit TitanDBOptions(const DBOptions& options) : DBOptions(options) {}
 
@@ -66,6 +153,20 @@ enum class TitanBlobRunMode {
                   // and store the value in SST file.
 };
 
+enum class TitanBlobChecksumPolicy {
+  kNone = 0,     // Record checksums are never verified.
+  kOnRead = 1,   // Every record read is verified.
+  kOnGC = 2,     // Only records read by GC and level merge are verified.
+  kSampled = 3,  // Like kOnGC, plus one in blob_checksum_sample_interval
+                 // foreground reads.
+};
+
+enum class TitanBlobCacheAdmission {
+  kAll = 0,      // Every record read is inserted into the blob cache.
+  kTinyLFU = 1,  // Once the blob cache is full, only records whose keys
+                 // were read recently before are inserted.
+};
+
 struct TitanOptionsHelper {
   static std::map<TitanBlobRunMode, std::string> blob_run_mode_to_string;
   static std::unordered_map<std::string, TitanBlobRunMode>
@@ -104,6 +205,102 @@ struct TitanCFOptions : public ColumnFamilyOptions {
   // Default: nullptr
   std::shared_ptr<Cache> blob_cache;
 
+  // Decides which records read from blob files are inserted into
+  // blob_cache. With kTinyLFU, the access frequency of records is tracked
+  // by a count-min sketch sized after the cache, so that values read only
+  // once, e.g. by a scan, don't displace frequently read ones.
+  //
+  // Default: kAll
+  TitanBlobCacheAdmission blob_cache_admission{TitanBlobCacheAdmission::kAll};
+
+  // If non-NULL, records evicted from blob_cache are kept compressed in
+  // this cache, and moved back into blob_cache when they are read again.
+  // Records that don't compress well are dropped on eviction.
+  //
+  // Default: nullptr
+  std::shared_ptr<Cache> blob_compressed_cache;
+
+  // The compression of records in blob_compressed_cache.
+  //
+  // Default: kLZ4Compression
+  CompressionType blob_compressed_cache_compression{kLZ4Compression};
+
+  // When a batched read fetches several records from the same blob file,
+  // records separated by no more than this many bytes are fetched with a
+  // single read, trading a few wasted bytes for fewer I/Os.
+  //
+  // Default: 4KB
+  uint64_t blob_read_coalesce_gap{4 << 10};
+
+  // If true, blob indexes are written in the compact format, which uses
+  // fixed-width fields and records the value size and whether the record
+  // is compressed. Reads of uncompressed records then fetch only the value
+  // bytes. Both formats can be read regardless of this option.
+  //
+  // Default: false
+  bool compact_blob_index{false};
+
+  // When to verify the checksums of blob records read from blob files.
+  // Records cached in the blob cache are not verified again.
+  //
+  // Default: kNone
+  TitanBlobChecksumPolicy blob_checksum_policy{TitanBlobChecksumPolicy::kNone};
+
+  // With kSampled, one in this many foreground reads is verified.
+  //
+  // Default: 64
+  uint32_t blob_checksum_sample_interval{64};
+
+  // If true, sorted blob files are read through a memory mapping instead
+  // of pread. Values are then returned without being copied, pinned by
+  // the opened file, and scans advise the kernel to read ahead.
+  //
+  // Default: false
+  bool mmap_sorted_blob_files{false};
+
+  // Blob files at this level or a deeper one are read through a memory
+  // mapping, see mmap_sorted_blob_files. Negative means no file is mapped
+  // because of its level.
+  //
+  // Default: -1
+  int mmap_blob_file_min_level{-1};
+
+  // If non-zero, separated values read very often are inlined back into
+  // SSTs by compaction, sparing reads of them the blob file I/O, and
+  // separated again once they cool down. Reads are sampled to estimate
+  // their frequency per key, and the inlined values of the hottest keys
+  // take at most this many bytes.
+  //
+  // Default: 0
+  uint64_t hot_value_inline_budget{0};
+
+  // Only values no larger than this are inlined when hot, see
+  // hot_value_inline_budget.
+  //
+  // Default: 16KB
+  uint64_t hot_value_max_size{16 << 10};
+
+  // One in this many reads is sampled to find hot values, see
+  // hot_value_inline_budget.
+  //
+  // Default: 16
+  uint32_t hot_value_sample_rate{16};
+
+  // Values written through TitanDB::PutStream are split into chunks of
+  // this many bytes, each stored and compressed as a blob record of its
+  // own, so that no read or write of the value needs a buffer larger than
+  // a chunk.
+  //
+  // Default: 1MB
+  uint64_t blob_chunk_size{1 << 20};
+
+  // If non-zero, values at least this large written with Put are stored in
+  // chunks the same way as values written through TitanDB::PutStream.
+  // Values in write batches are not chunked.
+  //
+  // Default: 0
+  uint64_t chunked_value_min_size{0};
+
   // Max batch size for GC.
   //
   // Default: 1GB
@@ -192,6 +389,21 @@ struct ImmutableTitanCFOptions {
         blob_file_compression(opts.blob_file_compression),
         blob_file_target_size(opts.blob_file_target_size),
         blob_cache(opts.blob_cache),
+        blob_cache_admission(opts.blob_cache_admission),
+        blob_compressed_cache(opts.blob_compressed_cache),
+        blob_compressed_cache_compression(
+            opts.blob_compressed_cache_compression),
+        blob_read_coalesce_gap(opts.blob_read_coalesce_gap),
+        compact_blob_index(opts.compact_blob_index),
+        blob_checksum_policy(opts.blob_checksum_policy),
+        blob_checksum_sample_interval(opts.blob_checksum_sample_interval),
+        mmap_sorted_blob_files(opts.mmap_sorted_blob_files),
+        mmap_blob_file_min_level(opts.mmap_blob_file_min_level),
+        hot_value_inline_budget(opts.hot_value_inline_budget),
+        hot_value_max_size(opts.hot_value_max_size),
+        hot_value_sample_rate(opts.hot_value_sample_rate),
+        blob_chunk_size(opts.blob_chunk_size),
+        chunked_value_min_size(opts.chunked_value_min_size),
         max_gc_batch_size(opts.max_gc_batch_size),
         min_gc_batch_size(opts.min_gc_batch_size),
         blob_file_discardable_ratio(opts.blob_file_discardable_ratio),
@@ -210,6 +422,34 @@ struct ImmutableTitanCFOptions {
 
   std::shared_ptr<Cache> blob_cache;
 
+  TitanBlobCacheAdmission blob_cache_admission;
+
+  std::shared_ptr<Cache> blob_compressed_cache;
+
+  CompressionType blob_compressed_cache_compression;
+
+  uint64_t blob_read_coalesce_gap;
+
+  bool compact_blob_index;
+
+  TitanBlobChecksumPolicy blob_checksum_policy;
+
+  uint32_t blob_checksum_sample_interval;
+
+  bool mmap_sorted_blob_files;
+
+  int mmap_blob_file_min_level;
+
+  uint64_t hot_value_inline_budget;
+
+  uint64_t hot_value_max_size;
+
+  uint32_t hot_value_sample_rate;
+
+  uint64_t blob_chunk_size;
+
+  uint64_t chunked_value_min_size;
+
   uint64_t max_gc_batch_size;
 
   uint64_t min_gc_batch_size;
@@ -263,6 +503,60 @@ struct TitanReadOptions : public ReadOptions {
   // Default: false
   bool key_only{false};
 
+  // Absolute time, in microseconds as returned by Env::NowMicros(), after
+  // which no more blob file I/O is started on behalf of this read. Such a
+  // read fails with Status::TimedOut. Zero means no deadline.
+  //
+  // Default: 0
+  uint64_t deadline{0};
+
+  // If true, iterators don't read blob files. value() of a blob entry is
+  // empty, while the "rocksdb.titandb.iterator.value-size" property gives
+  // the value size as TitanDB::GetValueSize does.
+  //
+  // Default: false
+  bool value_size_only{false};
+
+  // Maximum number of tasks a Scan splits its blob reads into. Values are
+  // grouped by blob file, and the files are spread over the tasks, which
+  // run on the read threads shared by the DB, see
+  // TitanDBOptions::num_blob_read_threads, and in the calling thread. Zero
+  // means one more than the number of read threads; one, or no read
+  // threads, reads every file in the calling thread.
+  //
+  // Default: 0
+  uint32_t scan_fan_out{0};
+
+  // Records of a Scan in the same blob file separated by no more than this
+  // many bytes are fetched with a single read, see
+  // TitanCFOptions::blob_read_coalesce_gap, which applies if it is larger.
+  // Scans over blob files sorted by level merge read runs of neighbouring
+  // records, so a larger gap trades wasted bytes for fewer I/Os there.
+  //
+  // Default: 0
+  uint64_t scan_coalesce_gap{0};
+
+  // Maximum number of entries an iterator moving forward looks ahead of
+  // its position. Their blob values are read on the read threads shared
+  // by the DB, see TitanDBOptions::num_blob_read_threads, so that Next()
+  // finds them in memory; without read threads the reads are only hinted
+  // to the OS. The window starts small, widens while Next() has to wait
+  // for values and narrows while they are ready early. Moving backward
+  // doesn't look ahead. Zero disables it.
+  //
+  // Default: 0
+  uint32_t iterator_lookahead{0};
+
+  // If true, iterators read the blob value of an entry only once value()
+  // is called for it, so that entries skipped on their keys cost no blob
+  // reads, see also TitanIterator::PrefetchValue. Values looked ahead,
+  // see iterator_lookahead, are still read. Since the read then happens
+  // in value(), status() must be checked after calling value(): a failed
+  // read leaves it non-ok and value() empty.
+  //
+  // Default: false
+  bool lazy_value{false};
+
   TitanReadOptions() = default;
   explicit TitanReadOptions(const ReadOptions& options)
       : ReadOptions(options) {}
@@ -0,0 +1,93 @@
+#include "blob_cache_admission.h"
+
+#include <algorithm>
+
+#include "util/hash.h"
+
+namespace rocksdb {
+namespace titandb {
+
+namespace {
+
+const size_t kMinSketchWidth = 1024;
+const size_t kAssumedValueSize = 4096;
+
+}  // namespace
+
+FrequencySketch::FrequencySketch(size_t entries) {
+  width_ = kMinSketchWidth;
+  while (width_ < entries) {
+    width_ <<= 1;
+  }
+  counters_.reset(new std::atomic<uint8_t>[width_ * kDepth]);
+  for (size_t i = 0; i < width_ * kDepth; i++) {
+    counters_[i].store(0, std::memory_order_relaxed);
+  }
+  sample_size_ = width_ * 10;
+}
+
+void FrequencySketch::Locate(const Slice& key, size_t* index) const {
+  // Double hashing gives independent enough rows from two hashes.
+  uint32_t h1 = Hash(key.data(), key.size(), 0x9e3779b9);
+  uint32_t h2 = Hash(key.data(), key.size(), 0x7f4a7c15) | 1;
+  for (int i = 0; i < kDepth; i++) {
+    index[i] = i * width_ + ((h1 + i * h2) & (width_ - 1));
+  }
+}
+
+void FrequencySketch::RecordAccess(const Slice& key) {
+  size_t index[kDepth];
+  Locate(key, index);
+  // Only the smallest counters are incremented, which keeps the
+  // overestimation of colliding keys low. Races only lose increments.
+  uint32_t min_count = MinCount(index);
+  if (min_count < kMaxCount) {
+    for (int i = 0; i < kDepth; i++) {
+      uint8_t count = counters_[index[i]].load(std::memory_order_relaxed);
+      if (count == min_count) {
+        counters_[index[i]].store(count + 1, std::memory_order_relaxed);
+      }
+    }
+  }
+  if (accesses_.fetch_add(1, std::memory_order_relaxed) + 1 == sample_size_) {
+    Age();
+  }
+}
+
+uint32_t FrequencySketch::Estimate(const Slice& key) const {
+  size_t index[kDepth];
+  Locate(key, index);
+  return MinCount(index);
+}
+
+uint32_t FrequencySketch::MinCount(const size_t* index) const {
+  uint32_t min_count = kMaxCount;
+  for (int i = 0; i < kDepth; i++) {
+    min_count = std::min<uint32_t>(
+        min_count, counters_[index[i]].load(std::memory_order_relaxed));
+  }
+  return min_count;
+}
+
+void FrequencySketch::Age() {
+  for (size_t i = 0; i < width_ * kDepth; i++) {
+    uint8_t count = counters_[i].load(std::memory_order_relaxed);
+    counters_[i].store(count >> 1, std::memory_order_relaxed);
+  }
+  accesses_.fetch_sub(sample_size_, std::memory_order_relaxed);
+}
+
+BlobCacheAdmission::BlobCacheAdmission(std::shared_ptr<Cache> cache)
+    : cache_(std::move(cache)),
+      sketch_(cache_->GetCapacity() / kAssumedValueSize) {}
+
+bool BlobCacheAdmission::Admit(const Slice& key, size_t charge) {
+  sketch_.RecordAccess(key);
+  if (cache_->GetUsage() + charge <= cache_->GetCapacity()) {
+    return true;
+  }
+  return sketch_.Estimate(key) > 1;
+}
+
+}  // namespace titandb
+}  // namespace rocksdb
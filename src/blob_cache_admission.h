@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include "rocksdb/cache.h"
+#include "rocksdb/slice.h"
+
+namespace rocksdb {
+namespace titandb {
+
+// Estimates the recent access frequency of keys with a count-min sketch
+// of 4-bit counters. Counters are halved whenever the sketch has recorded
+// ten accesses per counter of a row, so estimates follow the recent
+// workload.
+class FrequencySketch {
+ public:
+  // Sizes the sketch to track about "entries" keys.
+  explicit FrequencySketch(size_t entries);
+
+  FrequencySketch(const FrequencySketch&) = delete;
+  FrequencySketch& operator=(const FrequencySketch&) = delete;
+
+  // Records an access to "key".
+  void RecordAccess(const Slice& key);
+
+  // Returns the estimated number of recent accesses to "key".
+  uint32_t Estimate(const Slice& key) const;
+
+ private:
+  static const int kDepth = 4;
+  static const uint8_t kMaxCount = 15;
+
+  // Indexes of the counters of "key", one per row.
+  void Locate(const Slice& key, size_t* index) const;
+
+  // Returns the smallest of the counters at "index".
+  uint32_t MinCount(const size_t* index) const;
+
+  // Halves all counters.
+  void Age();
+
+  // Counters per row, a power of two.
+  size_t width_;
+  std::unique_ptr<std::atomic<uint8_t>[]> counters_;
+  // Accesses recorded since the last aging, and the number triggering it.
+  std::atomic<uint64_t> accesses_{0};
+  uint64_t sample_size_;
+};
+
+// TinyLFU admission in front of the blob cache. As the cache doesn't
+// expose its eviction victim, a candidate is compared against the
+// frequency of a single earlier access instead: once the cache is full,
+// keys read for the first time in the window of the sketch are not
+// admitted.
+class BlobCacheAdmission {
+ public:
+  // Sizes the sketch after the capacity of "cache", assuming 4KB values.
+  explicit BlobCacheAdmission(std::shared_ptr<Cache> cache);
+
+  // Records an access to "key", e.g. a cache hit.
+  void RecordAccess(const Slice& key) { sketch_.RecordAccess(key); }
+
+  // Records an access to "key" and returns true if a value of "charge"
+  // bytes read for it should be inserted into the cache.
+  bool Admit(const Slice& key, size_t charge);
+
+  // Returns the estimated number of recent accesses to "key".
+  uint32_t Estimate(const Slice& key) const { return sketch_.Estimate(key); }
+
+ private:
+  std::shared_ptr<Cache> cache_;
+  FrequencySketch sketch_;
+};
+
+}  // namespace titandb
+}  // namespace rocksdb
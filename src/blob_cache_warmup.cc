@@ -0,0 +1,133 @@
+#include "blob_cache_warmup.h"
+
+#include <algorithm>
+
+#include "util/coding.h"
+#include "util/crc32c.h"
+#include "util/hash.h"
+
+namespace rocksdb {
+namespace titandb {
+
+namespace {
+
+// File layout: magic, then varint encoded (cf id, file number, offset,
+// size) of every blob, then the masked crc32c of everything before.
+const uint32_t kHotBlobsMagic = 0x54484231;
+
+}  // namespace
+
+BlobAccessTracker::BlobAccessTracker(size_t capacity)
+    : stripe_capacity_(std::max<size_t>(capacity / kNumStripes, 1)),
+      stripes_(new Stripe[kNumStripes]) {}
+
+void BlobAccessTracker::Record(uint64_t file_number,
+                               const BlobHandle& handle) {
+  uint64_t key[2] = {file_number, handle.offset};
+  Stripe& stripe =
+      stripes_[Hash(reinterpret_cast<const char*>(key), sizeof(key), 0) %
+               kNumStripes];
+  Access access{seq_.fetch_add(1, std::memory_order_relaxed), file_number,
+                handle};
+  MutexLock l(&stripe.mutex);
+  if (stripe.ring.size() < stripe_capacity_) {
+    stripe.ring.push_back(access);
+  } else {
+    stripe.ring[stripe.next] = access;
+    stripe.next = (stripe.next + 1) % stripe_capacity_;
+  }
+}
+
+void BlobAccessTracker::GetRecent(uint32_t cf_id,
+                                  std::vector<HotBlob>* blobs) const {
+  std::vector<Access> accesses;
+  for (size_t i = 0; i < kNumStripes; i++) {
+    MutexLock l(&stripes_[i].mutex);
+    accesses.insert(accesses.end(), stripes_[i].ring.begin(),
+                    stripes_[i].ring.end());
+  }
+  // Keeps the latest access of every record.
+  std::sort(accesses.begin(), accesses.end(),
+            [](const Access& a, const Access& b) {
+              if (a.file_number != b.file_number) {
+                return a.file_number < b.file_number;
+              }
+              if (a.handle.offset != b.handle.offset) {
+                return a.handle.offset < b.handle.offset;
+              }
+              return a.seq > b.seq;
+            });
+  auto end = std::unique(accesses.begin(), accesses.end(),
+                         [](const Access& a, const Access& b) {
+                           return a.file_number == b.file_number &&
+                                  a.handle.offset == b.handle.offset;
+                         });
+  accesses.erase(end, accesses.end());
+  std::sort(accesses.begin(), accesses.end(),
+            [](const Access& a, const Access& b) { return a.seq > b.seq; });
+  for (const auto& access : accesses) {
+    HotBlob blob;
+    blob.cf_id = cf_id;
+    blob.file_number = access.file_number;
+    blob.handle = access.handle;
+    blobs->push_back(blob);
+  }
+}
+
+Status WriteHotBlobs(Env* env, const std::string& path,
+                     const std::vector<HotBlob>& blobs) {
+  std::string contents;
+  PutFixed32(&contents, kHotBlobsMagic);
+  for (const auto& blob : blobs) {
+    PutVarint32(&contents, blob.cf_id);
+    PutVarint64(&contents, blob.file_number);
+    PutVarint64(&contents, blob.handle.offset);
+    PutVarint64(&contents, blob.handle.size);
+  }
+  PutFixed32(&contents,
+             crc32c::Mask(crc32c::Value(contents.data(), contents.size())));
+
+  // Readers never see a partly written file.
+  std::string tmp_path = path + ".tmp";
+  Status s = WriteStringToFile(env, contents, tmp_path, true /*should_sync*/);
+  if (s.ok()) {
+    s = env->RenameFile(tmp_path, path);
+  }
+  if (!s.ok()) {
+    env->DeleteFile(tmp_path);
+  }
+  return s;
+}
+
+Status ReadHotBlobs(Env* env, const std::string& path,
+                    std::vector<HotBlob>* blobs) {
+  std::string contents;
+  Status s = ReadFileToString(env, path, &contents);
+  if (!s.ok()) {
+    return s;
+  }
+  if (contents.size() < 8 ||
+      DecodeFixed32(contents.data()) != kHotBlobsMagic) {
+    return Status::Corruption("not a hot blobs file", path);
+  }
+  size_t body_size = contents.size() - 4;
+  if (crc32c::Unmask(DecodeFixed32(contents.data() + body_size)) !=
+      crc32c::Value(contents.data(), body_size)) {
+    return Status::Corruption("hot blobs file checksum mismatch", path);
+  }
+  Slice input(contents.data() + 4, body_size - 4);
+  while (!input.empty()) {
+    HotBlob blob;
+    if (!GetVarint32(&input, &blob.cf_id) ||
+        !GetVarint64(&input, &blob.file_number) ||
+        !GetVarint64(&input, &blob.handle.offset) ||
+        !GetVarint64(&input, &blob.handle.size)) {
+      return Status::Corruption("bad hot blob entry", path);
+    }
+    blobs->push_back(blob);
+  }
+  return Status::OK();
+}
+
+}  // namespace titandb
+}  // namespace rocksdb
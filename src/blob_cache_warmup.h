@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rocksdb/env.h"
+#include "util/mutexlock.h"
+
+#include "blob_format.h"
+
+namespace rocksdb {
+namespace titandb {
+
+// A blob record to load into the blob cache of its column family.
+struct HotBlob {
+  uint32_t cf_id{0};
+  uint64_t file_number{0};
+  BlobHandle handle;
+};
+
+// Remembers the blob records read into the blob cache most recently. The
+// keys of a cache can't be listed, so this stands in for the contents of
+// the blob cache. Records are spread over stripes by their handle, so
+// concurrent readers rarely contend and every record has one stripe.
+class BlobAccessTracker {
+ public:
+  // Keeps the latest "capacity" accesses, at least one per stripe.
+  explicit BlobAccessTracker(size_t capacity);
+
+  BlobAccessTracker(const BlobAccessTracker&) = delete;
+  BlobAccessTracker& operator=(const BlobAccessTracker&) = delete;
+
+  // Records an access to the record "handle" of blob file "file_number".
+  void Record(uint64_t file_number, const BlobHandle& handle);
+
+  // Appends the tracked records to "blobs", most recently accessed first
+  // and each only once, with their "cf_id" set to "cf_id".
+  void GetRecent(uint32_t cf_id, std::vector<HotBlob>* blobs) const;
+
+ private:
+  struct Access {
+    uint64_t seq;
+    uint64_t file_number;
+    BlobHandle handle;
+  };
+
+  struct Stripe {
+    mutable port::Mutex mutex;
+    std::vector<Access> ring;
+    size_t next{0};
+  };
+
+  static const size_t kNumStripes = 16;
+
+  const size_t stripe_capacity_;
+  std::atomic<uint64_t> seq_{0};
+  std::unique_ptr<Stripe[]> stripes_;
+};
+
+// Writes "blobs" to the file "path", replacing it atomically.
+Status WriteHotBlobs(Env* env, const std::string& path,
+                     const std::vector<HotBlob>& blobs);
+
+// Reads the blobs written by WriteHotBlobs from the file "path".
+Status ReadHotBlobs(Env* env, const std::string& path,
+                    std::vector<HotBlob>* blobs);
+
+}  // namespace titandb
+}  // namespace rocksdb
@@ -0,0 +1,235 @@
+#include "blob_chunk.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "util.h"
+
+namespace rocksdb {
+namespace titandb {
+
+BlobChunkWriter::BlobChunkWriter(BlobFileBuilder* builder, const Slice& key,
+                                 uint64_t chunk_size)
+    : builder_(builder),
+      key_(key.ToString()),
+      chunk_size_(std::max<uint64_t>(chunk_size, 1)) {
+  table_.chunk_size = chunk_size_;
+}
+
+void BlobChunkWriter::Append(const Slice& data) {
+  Slice input = data;
+  while (!input.empty()) {
+    if (buffer_.empty() && input.size() >= chunk_size_) {
+      // Whole chunks are written out without being copied.
+      WriteChunk(Slice(input.data(), static_cast<size_t>(chunk_size_)));
+      input.remove_prefix(static_cast<size_t>(chunk_size_));
+      continue;
+    }
+    size_t n = static_cast<size_t>(
+        std::min<uint64_t>(input.size(), chunk_size_ - buffer_.size()));
+    buffer_.append(input.data(), n);
+    input.remove_prefix(n);
+    if (buffer_.size() == chunk_size_) {
+      WriteChunk(buffer_);
+      buffer_.clear();
+    }
+  }
+}
+
+void BlobChunkWriter::WriteChunk(const Slice& chunk) {
+  BlobRecord record;
+  record.key = key_;
+  record.value = chunk;
+  BlobHandle handle;
+  builder_->Add(record, &handle);
+  if (table_.record_sizes.empty()) {
+    first_offset_ = handle.offset;
+  }
+  table_.record_sizes.push_back(handle.size);
+  value_size_ += chunk.size();
+}
+
+Status BlobChunkWriter::Finish(BlobIndex* index) {
+  if (!buffer_.empty()) {
+    WriteChunk(buffer_);
+    buffer_.clear();
+  }
+  std::string table;
+  table_.EncodeTo(&table);
+  BlobRecord record;
+  record.key = key_;
+  record.value = table;
+  BlobHandle handle;
+  builder_->Add(record, &handle);
+  if (!builder_->status().ok()) {
+    return builder_->status();
+  }
+  if (table_.record_sizes.empty()) {
+    first_offset_ = handle.offset;
+  }
+  index->blob_handle.offset = first_offset_;
+  index->blob_handle.size = handle.offset + handle.size - first_offset_;
+  index->has_value_size = true;
+  index->compressed = false;
+  index->value_size = value_size_;
+  index->chunked = true;
+  index->chunk_table_size = handle.size;
+  return Status::OK();
+}
+
+Status BlobChunkReader::Open(const ReadOptions& options,
+                             std::shared_ptr<BlobFileCache> file_cache,
+                             uint64_t file_number, uint64_t file_size,
+                             const BlobIndex& index,
+                             std::unique_ptr<BlobChunkReader>* result) {
+  assert(index.chunked);
+  std::unique_ptr<BlobChunkReader> reader(
+      new BlobChunkReader(options, file_cache, file_number, file_size));
+  BlobRecord record;
+  PinnableSlice buffer;
+  Status s = file_cache->Get(options, file_number, file_size,
+                             index.ChunkTableHandle(), &record, &buffer);
+  if (!s.ok()) {
+    return s;
+  }
+  s = DecodeInto(record.value, &reader->table_);
+  if (!s.ok()) {
+    return s;
+  }
+
+  const BlobChunkTable& table = reader->table_;
+  uint64_t offset = index.blob_handle.offset;
+  for (uint64_t size : table.record_sizes) {
+    reader->offsets_.push_back(offset);
+    offset += size;
+  }
+  uint64_t num_chunks = table.record_sizes.size();
+  if (offset + index.chunk_table_size !=
+          index.blob_handle.offset + index.blob_handle.size ||
+      index.value_size > num_chunks * table.chunk_size ||
+      (num_chunks > 0 &&
+       index.value_size <= (num_chunks - 1) * table.chunk_size)) {
+    return Status::Corruption("BlobChunkTable",
+                              "chunks don't match the blob index");
+  }
+  reader->value_size_ = index.value_size;
+  *result = std::move(reader);
+  return s;
+}
+
+Status BlobChunkReader::ReadChunk(size_t i, Slice* chunk,
+                                  PinnableSlice* buffer) {
+  assert(i < offsets_.size());
+  BlobHandle handle;
+  handle.offset = offsets_[i];
+  handle.size = table_.record_sizes[i];
+  BlobRecord record;
+  buffer->Reset();
+  Status s = file_cache_->Get(options_, file_number_, file_size_, handle,
+                              &record, buffer);
+  if (!s.ok()) {
+    return s;
+  }
+  uint64_t start = i * table_.chunk_size;
+  if (record.value.size() !=
+      std::min(table_.chunk_size, value_size_ - start)) {
+    return Status::Corruption("BlobChunkTable", "chunk size mismatch");
+  }
+  *chunk = record.value;
+  return s;
+}
+
+Status BlobChunkReader::Read(uint64_t offset, uint64_t len,
+                             PinnableSlice* value) {
+  value->Reset();
+  if (offset >= value_size_ || len == 0) {
+    value->PinSelf(Slice());
+    return Status::OK();
+  }
+  len = std::min(len, value_size_ - offset);
+  size_t first = static_cast<size_t>(offset / table_.chunk_size);
+  size_t last = static_cast<size_t>((offset + len - 1) / table_.chunk_size);
+
+  Status s;
+  Slice chunk;
+  PinnableSlice buffer;
+  if (first == last) {
+    s = ReadChunk(first, &chunk, &buffer);
+    if (s.ok() && buffer.IsPinned()) {
+      PinPartialValue(chunk, offset - first * table_.chunk_size, len, &buffer,
+                      value);
+      return s;
+    }
+  }
+  if (!s.ok()) {
+    return s;
+  }
+
+  // Spans several chunks, copies them into a buffer of its own.
+  CacheAllocationPtr data(new char[len]);
+  uint64_t copied = 0;
+  for (size_t i = first; i <= last; i++) {
+    if (i != first || first != last) {
+      s = ReadChunk(i, &chunk, &buffer);
+      if (!s.ok()) {
+        return s;
+      }
+    }
+    uint64_t begin = i == first ? offset - first * table_.chunk_size : 0;
+    uint64_t n = std::min<uint64_t>(chunk.size() - begin, len - copied);
+    memcpy(data.get() + copied, chunk.data() + begin, n);
+    copied += n;
+  }
+  assert(copied == len);
+  value->PinSlice(Slice(data.get(), len), OwnedSlice::CleanupFunc,
+                  data.release(), nullptr);
+  return s;
+}
+
+BlobValueStream::BlobValueStream(std::unique_ptr<PinnableSlice> value)
+    : value_(std::move(value)),
+      value_size_(value_->size()),
+      chunk_size_(std::max<uint64_t>(value_size_, 1)),
+      chunk_index_(0),
+      chunk_(*value_) {}
+
+BlobValueStream::BlobValueStream(std::unique_ptr<BlobChunkReader> reader,
+                                 std::shared_ptr<ManagedSnapshot> snapshot)
+    : reader_(std::move(reader)),
+      snapshot_(std::move(snapshot)),
+      value_size_(reader_->value_size()),
+      chunk_size_(reader_->chunk_size()),
+      chunk_index_(std::numeric_limits<size_t>::max()) {}
+
+Status BlobValueStream::Read(size_t n, Slice* result, char* scratch) {
+  size_t copied = 0;
+  while (copied < n && pos_ < value_size_) {
+    size_t index = static_cast<size_t>(pos_ / chunk_size_);
+    if (index != chunk_index_) {
+      // Only one chunk is held at a time.
+      chunk_index_ = std::numeric_limits<size_t>::max();
+      Status s = reader_->ReadChunk(index, &chunk_, &chunk_buffer_);
+      if (!s.ok()) {
+        return s;
+      }
+      chunk_index_ = index;
+    }
+    uint64_t begin = pos_ - index * chunk_size_;
+    size_t len = static_cast<size_t>(
+        std::min<uint64_t>(chunk_.size() - begin, n - copied));
+    memcpy(scratch + copied, chunk_.data() + begin, len);
+    copied += len;
+    pos_ += len;
+  }
+  *result = Slice(scratch, copied);
+  return Status::OK();
+}
+
+Status BlobValueStream::Skip(uint64_t n) {
+  pos_ = std::min(pos_ + n, value_size_);
+  return Status::OK();
+}
+
+}  // namespace titandb
+}  // namespace rocksdb
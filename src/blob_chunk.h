@@ -0,0 +1,126 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rocksdb/db.h"
+#include "rocksdb/env.h"
+
+#include "blob_file_builder.h"
+#include "blob_file_cache.h"
+#include "blob_format.h"
+
+namespace rocksdb {
+namespace titandb {
+
+// Splits a value into chunks written as blob records, see BlobChunkTable.
+// At most one chunk of the value is buffered.
+class BlobChunkWriter {
+ public:
+  // Writes the chunks of the value of "key" through "builder", whose file
+  // must hold nothing else, in chunks of "chunk_size" bytes.
+  BlobChunkWriter(BlobFileBuilder* builder, const Slice& key,
+                  uint64_t chunk_size);
+
+  BlobChunkWriter(const BlobChunkWriter&) = delete;
+  BlobChunkWriter& operator=(const BlobChunkWriter&) = delete;
+
+  // Appends "data" to the value, writing out every chunk filled.
+  void Append(const Slice& data);
+
+  // Writes out the last chunk and the chunk table, and points "index" at
+  // them. The file number is left to the caller.
+  Status Finish(BlobIndex* index);
+
+ private:
+  void WriteChunk(const Slice& chunk);
+
+  BlobFileBuilder* builder_;
+  std::string key_;
+  uint64_t chunk_size_;
+  // The start of the value not filling a chunk yet.
+  std::string buffer_;
+  BlobChunkTable table_;
+  uint64_t value_size_{0};
+  uint64_t first_offset_{0};
+};
+
+// Reads a chunked value one chunk at a time through the blob file cache,
+// so that chunks are cached and verified like any other blob record.
+class BlobChunkReader {
+ public:
+  // Reads the chunk table of the value pointed by "index", which must be
+  // chunked, in the file "file_number" of "file_size" bytes.
+  static Status Open(const ReadOptions& options,
+                     std::shared_ptr<BlobFileCache> file_cache,
+                     uint64_t file_number, uint64_t file_size,
+                     const BlobIndex& index,
+                     std::unique_ptr<BlobChunkReader>* result);
+
+  BlobChunkReader(const BlobChunkReader&) = delete;
+  BlobChunkReader& operator=(const BlobChunkReader&) = delete;
+
+  uint64_t value_size() const { return value_size_; }
+  uint64_t chunk_size() const { return table_.chunk_size; }
+
+  // Reads the chunk "i" into "chunk", pinned in "buffer".
+  Status ReadChunk(size_t i, Slice* chunk, PinnableSlice* buffer);
+
+  // Reads up to "len" bytes of the value starting at "offset" into
+  // "value", which is shorter if the value ends earlier. Only the chunks
+  // overlapping the range are read. "value" never points into its own
+  // memory, so it can be handed over with PinnableSlice::PinSlice.
+  Status Read(uint64_t offset, uint64_t len, PinnableSlice* value);
+
+ private:
+  BlobChunkReader(const ReadOptions& options,
+                  std::shared_ptr<BlobFileCache> file_cache,
+                  uint64_t file_number, uint64_t file_size)
+      : options_(options),
+        file_cache_(std::move(file_cache)),
+        file_number_(file_number),
+        file_size_(file_size) {}
+
+  ReadOptions options_;
+  std::shared_ptr<BlobFileCache> file_cache_;
+  uint64_t file_number_;
+  uint64_t file_size_;
+  uint64_t value_size_{0};
+  BlobChunkTable table_;
+  // Offsets of the records of the chunks.
+  std::vector<uint64_t> offsets_;
+};
+
+// Streams a value, see TitanDB::GetStream. A chunked value is read a chunk
+// at a time as it is consumed, others are read at once.
+class BlobValueStream : public SequentialFile {
+ public:
+  // Streams "value", which has been read already.
+  explicit BlobValueStream(std::unique_ptr<PinnableSlice> value);
+
+  // Streams the value of "reader". "snapshot" keeps the chunks from being
+  // purged until the stream is destroyed.
+  BlobValueStream(std::unique_ptr<BlobChunkReader> reader,
+                  std::shared_ptr<ManagedSnapshot> snapshot);
+
+  Status Read(size_t n, Slice* result, char* scratch) override;
+
+  Status Skip(uint64_t n) override;
+
+ private:
+  std::unique_ptr<PinnableSlice> value_;
+  std::unique_ptr<BlobChunkReader> reader_;
+  std::shared_ptr<ManagedSnapshot> snapshot_;
+  uint64_t value_size_;
+  uint64_t chunk_size_;
+  uint64_t pos_{0};
+
+  // The chunk read last, if "chunk_index_" is valid.
+  size_t chunk_index_;
+  Slice chunk_;
+  PinnableSlice chunk_buffer_;
+};
+
+}  // namespace titandb
+}  // namespace rocksdb
@@ -51,6 +51,14 @@ void BlobFileBuilder::Add(const BlobRecord& record, BlobHandle* handle) {
   }
 }
 
+void BlobFileBuilder::Add(const BlobRecord& record, BlobIndex* index) {
+  Add(record, &index->blob_handle);
+  if (!ok()) return;
+  index->has_value_size = true;
+  index->compressed = encoder_.GetCompression() != kNoCompression;
+  index->value_size = record.value.size();
+}
+
 Status BlobFileBuilder::Finish() {
   if (!ok()) return status();
 
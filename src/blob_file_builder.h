@@ -42,6 +42,10 @@ class BlobFileBuilder {
   // Adds the record to the file and points the handle to it.
   void Add(const BlobRecord& record, BlobHandle* handle);
 
+  // Same as above, but also records the value size and compression of the
+  // record in the index. The file number is left to the caller.
+  void Add(const BlobRecord& record, BlobIndex* index);
+
   // Returns non-ok iff some error has been detected.
   Status status() const { return status_; }
 
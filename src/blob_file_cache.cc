@@ -1,5 +1,7 @@
 #include "blob_file_cache.h"
 
+#include <algorithm>
+
 #include "file/filename.h"
 #include "util.h"
 
@@ -12,31 +14,113 @@ Slice EncodeFileNumber(const uint64_t* number) {
   return Slice(reinterpret_cast<const char*>(number), sizeof(*number));
 }
 
+// Blob cache bytes per tracked access.
+const size_t kTrackedValueSize = 4096;
+const size_t kMaxTrackedAccesses = 1 << 20;
+
 }  // namespace
 
 BlobFileCache::BlobFileCache(const TitanDBOptions& db_options,
                              const TitanCFOptions& cf_options,
-                             std::shared_ptr<Cache> cache, TitanStats* stats)
+                             std::shared_ptr<Cache> cache, TitanStats* stats,
+                             std::shared_ptr<BlobFlashCache> flash_cache)
     : env_(db_options.env),
       env_options_(db_options),
       db_options_(db_options),
       cf_options_(cf_options),
       cache_(cache),
-      stats_(stats) {}
+      stats_(stats) {
+  if (db_options.use_direct_blob_reads) {
+    env_options_.use_direct_reads = true;
+  }
+  if (cf_options.blob_cache &&
+      cf_options.blob_cache_admission == TitanBlobCacheAdmission::kTinyLFU) {
+    resources_.admission =
+        std::make_shared<BlobCacheAdmission>(cf_options.blob_cache);
+  }
+  if (env_options_.use_direct_reads) {
+    resources_.buffer_pool = std::make_shared<AlignedBufferPool>(
+        db_options.blob_direct_read_buffer_pool_size);
+  }
+  resources_.flash_cache = std::move(flash_cache);
+  if (cf_options.blob_cache && db_options.blob_cache_dump_period_sec > 0) {
+    access_tracker_.reset(new BlobAccessTracker(
+        std::min(cf_options.blob_cache->GetCapacity() / kTrackedValueSize,
+                 kMaxTrackedAccesses)));
+  }
+}
 
 Status BlobFileCache::Get(const ReadOptions& options, uint64_t file_number,
                           uint64_t file_size, const BlobHandle& handle,
-                          BlobRecord* record, PinnableSlice* buffer) {
+                          BlobRecord* record, PinnableSlice* buffer,
+                          uint64_t raw_value_size) {
   Cache::Handle* cache_handle = nullptr;
-  Status s = FindFile(file_number, file_size, &cache_handle);
+  Status s = FindFile(file_number, file_size, &cache_handle,
+                      options.read_tier == kBlockCacheTier);
   if (!s.ok()) return s;
 
   auto reader = reinterpret_cast<BlobFileReader*>(cache_->Value(cache_handle));
-  s = reader->Get(options, handle, record, buffer);
-  cache_->Release(cache_handle);
+  s = reader->Get(options, handle, record, buffer, raw_value_size);
+  PinOrRelease(reader, cache_handle, s, buffer);
+  if (s.ok() && access_tracker_ && options.fill_cache) {
+    access_tracker_->Record(file_number, handle);
+  }
   return s;
 }
 
+Status BlobFileCache::GetPartial(const ReadOptions& options,
+                                 uint64_t file_number, uint64_t file_size,
+                                 const BlobHandle& handle,
+                                 uint64_t raw_value_size, bool only_value,
+                                 uint64_t offset, uint64_t len,
+                                 PinnableSlice* value) {
+  Cache::Handle* cache_handle = nullptr;
+  Status s = FindFile(file_number, file_size, &cache_handle,
+                      options.read_tier == kBlockCacheTier);
+  if (!s.ok()) return s;
+
+  auto reader = reinterpret_cast<BlobFileReader*>(cache_->Value(cache_handle));
+  s = reader->GetPartial(options, handle, raw_value_size, only_value, offset,
+                         len, value);
+  PinOrRelease(reader, cache_handle, s, value);
+  return s;
+}
+
+void BlobFileCache::MultiGet(const ReadOptions& options, uint64_t file_number,
+                             uint64_t file_size,
+                             const std::vector<BlobGetRequest*>& requests,
+                             uint64_t max_gap) {
+  Cache::Handle* cache_handle = nullptr;
+  Status s = FindFile(file_number, file_size, &cache_handle,
+                      options.read_tier == kBlockCacheTier);
+  if (!s.ok()) {
+    for (auto* request : requests) {
+      request->status = s;
+    }
+    return;
+  }
+
+  auto reader = reinterpret_cast<BlobFileReader*>(cache_->Value(cache_handle));
+  reader->MultiGet(options, requests, max_gap);
+  if (access_tracker_ && options.fill_cache) {
+    for (auto* request : requests) {
+      if (request->status.ok()) {
+        access_tracker_->Record(file_number, request->handle);
+      }
+    }
+  }
+  if (reader->mmapped()) {
+    for (auto* request : requests) {
+      if (request->status.ok()) {
+        cache_->Ref(cache_handle);
+        request->buffer->RegisterCleanup(&UnrefCacheHandle, cache_.get(),
+                                         cache_handle);
+      }
+    }
+  }
+  cache_->Release(cache_handle);
+}
+
 Status BlobFileCache::NewPrefetcher(uint64_t file_number, uint64_t file_size,
                                     std::unique_ptr<BlobFilePrefetcher>* result,
                                     bool sorted_blob) {
@@ -51,12 +135,42 @@ Status BlobFileCache::NewPrefetcher(uint64_t file_number, uint64_t file_size,
   return s;
 }
 
+Status BlobFileCache::Preload(uint64_t file_number, uint64_t file_size) {
+  Cache::Handle* cache_handle = nullptr;
+  Status s = FindFile(file_number, file_size, &cache_handle, false /*no_io*/,
+                      true /*trust_file_size*/);
+  if (s.ok()) {
+    cache_->Release(cache_handle);
+  }
+  return s;
+}
+
+void BlobFileCache::SetMmapReads(uint64_t file_number) {
+  MutexLock l(&mmap_mutex_);
+  mmap_files_.insert(file_number);
+}
+
 void BlobFileCache::Evict(uint64_t file_number) {
+  {
+    MutexLock l(&mmap_mutex_);
+    mmap_files_.erase(file_number);
+  }
   cache_->Erase(EncodeFileNumber(&file_number));
 }
 
+void BlobFileCache::PinOrRelease(BlobFileReader* reader,
+                                 Cache::Handle* cache_handle, const Status& s,
+                                 PinnableSlice* buffer) {
+  if (s.ok() && reader->mmapped()) {
+    buffer->RegisterCleanup(&UnrefCacheHandle, cache_.get(), cache_handle);
+  } else {
+    cache_->Release(cache_handle);
+  }
+}
+
 Status BlobFileCache::FindFile(uint64_t file_number, uint64_t file_size,
-                               Cache::Handle** handle) {
+                               Cache::Handle** handle, bool no_io,
+                               bool trust_file_size) {
   Status s;
   Slice cache_key = EncodeFileNumber(&file_number);
   *handle = cache_->Lookup(cache_key);
@@ -64,10 +178,20 @@ Status BlobFileCache::FindFile(uint64_t file_number, uint64_t file_size,
     // TODO: add file reader cache hit/miss metrics
     return s;
   }
+  if (no_io) {
+    return Status::Incomplete("blob file not opened, no I/O allowed");
+  }
+  auto file_name = BlobFileName(db_options_.dirname, file_number);
+  bool verify_footer = true;
+  if (trust_file_size) {
+    // A size check costs a stat rather than a read.
+    uint64_t actual_size = 0;
+    verify_footer = !env_->GetFileSize(file_name, &actual_size).ok() ||
+                    actual_size != file_size;
+  }
   std::unique_ptr<RandomAccessFileReader> file;
   {
     std::unique_ptr<RandomAccessFile> f;
-    auto file_name = BlobFileName(db_options_.dirname, file_number);
     s = env_->NewRandomAccessFile(file_name, &f, env_options_);
     if (!s.ok()) return s;
     if (db_options_.advise_random_on_open) {
@@ -76,9 +200,15 @@ Status BlobFileCache::FindFile(uint64_t file_number, uint64_t file_size,
     file.reset(new RandomAccessFileReader(std::move(f), file_name));
   }
 
+  bool mmap_reads = false;
+  {
+    MutexLock l(&mmap_mutex_);
+    mmap_reads = mmap_files_.count(file_number) > 0;
+  }
   std::unique_ptr<BlobFileReader> reader;
   s = BlobFileReader::Open(cf_options_, std::move(file), file_size, &reader,
-                           stats_);
+                           stats_, db_options_.blob_io_uring_queue_depth,
+                           verify_footer, mmap_reads, resources_);
   if (!s.ok()) return s;
 
   cache_->Insert(cache_key, reader.release(), 1,
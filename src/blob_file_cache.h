@@ -1,10 +1,14 @@
 #pragma once
 
+#include <unordered_set>
+
+#include "blob_cache_warmup.h"
 #include "blob_file_reader.h"
 #include "blob_format.h"
 #include "rocksdb/options.h"
 #include "titan/options.h"
 #include "titan_stats.h"
+#include "util/mutexlock.h"
 
 namespace rocksdb {
 namespace titandb {
@@ -14,30 +18,73 @@ class BlobFileCache {
   // Constructs a blob file cache to cache opened files.
   BlobFileCache(const TitanDBOptions& db_options,
                 const TitanCFOptions& cf_options, std::shared_ptr<Cache> cache,
-                TitanStats* stats);
+                TitanStats* stats,
+                std::shared_ptr<BlobFlashCache> flash_cache = nullptr);
 
   // Gets the blob record pointed by the handle in the specified file
   // number. The corresponding file size must be exactly "file_size"
   // bytes. The provided buffer is used to store the record data, so
-  // the buffer must be valid when the record is used.
+  // the buffer must be valid when the record is used. See
+  // BlobFileReader::Get for "raw_value_size".
   Status Get(const ReadOptions& options, uint64_t file_number,
              uint64_t file_size, const BlobHandle& handle, BlobRecord* record,
-             PinnableSlice* buffer);
+             PinnableSlice* buffer, uint64_t raw_value_size = 0);
+
+  // Gets part of the value of the blob record pointed by the handle, see
+  // BlobFileReader::GetPartial.
+  Status GetPartial(const ReadOptions& options, uint64_t file_number,
+                    uint64_t file_size, const BlobHandle& handle,
+                    uint64_t raw_value_size, bool only_value, uint64_t offset,
+                    uint64_t len, PinnableSlice* value);
+
+  // Gets the blob records of a batch of requests against the specified
+  // file number, opening the file at most once. See
+  // BlobFileReader::MultiGet for the meaning of "max_gap".
+  void MultiGet(const ReadOptions& options, uint64_t file_number,
+                uint64_t file_size,
+                const std::vector<BlobGetRequest*>& requests,
+                uint64_t max_gap);
 
   // Creates a prefetcher for the specified file number.
   Status NewPrefetcher(uint64_t file_number, uint64_t file_size,
                        std::unique_ptr<BlobFilePrefetcher>* result,
                        bool sorted_blob = false);
 
+  // Opens the specified file ahead of its first read and caches it. The
+  // footer is not read if the file on disk has exactly "file_size" bytes,
+  // which the manifest only records for finished files.
+  Status Preload(uint64_t file_number, uint64_t file_size);
+
+  // Makes the specified file be read through a memory mapping once it is
+  // opened. Records read from it keep the file open until the buffers
+  // they are pinned in are released.
+  void SetMmapReads(uint64_t file_number);
+
   // Evicts the file cache for the specified file number.
   void Evict(uint64_t file_number);
 
+  // Returns the tracker of the records recently read into the blob
+  // cache, or null if they are not tracked, see
+  // TitanDBOptions::blob_cache_dump_period_sec.
+  const BlobAccessTracker* access_tracker() const {
+    return access_tracker_.get();
+  }
+
  private:
+  // Keeps the reader behind "cache_handle" alive as long as "buffer" if
+  // records read from it may point into its mapping, otherwise releases
+  // the handle.
+  void PinOrRelease(BlobFileReader* reader, Cache::Handle* cache_handle,
+                    const Status& s, PinnableSlice* buffer);
+
   // Finds the file for the specified file number. Opens the file if
   // the file is not found in the cache and caches it.
-  // If successful, sets "*handle" to the cached file.
+  // If successful, sets "*handle" to the cached file. With "no_io" a file
+  // that is not open yet is reported as Incomplete instead. With
+  // "trust_file_size" the footer is skipped if the file size matches.
   Status FindFile(uint64_t file_number, uint64_t file_size,
-                  Cache::Handle** handle);
+                  Cache::Handle** handle, bool no_io = false,
+                  bool trust_file_size = false);
 
   Env* env_;
   EnvOptions env_options_;
@@ -45,6 +92,14 @@ class BlobFileCache {
   TitanCFOptions cf_options_;
   std::shared_ptr<Cache> cache_;
   TitanStats* stats_;
+  // Shared by all readers, which may outlive this cache. The admission
+  // policy is shared so that readers see the same access frequencies.
+  BlobReadResources resources_;
+  std::unique_ptr<BlobAccessTracker> access_tracker_;
+
+  port::Mutex mmap_mutex_;
+  // Files to be read through a memory mapping.
+  std::unordered_set<uint64_t> mmap_files_;
 };
 
 }  // namespace titandb
@@ -111,6 +111,10 @@ void BlobFileIterator::GetBlobRecord() {
   // is only used for GC, we always set for_compaction to true.
   status_ = file_->Read(iterate_offset_ + kRecordHeaderSize, record_size,
                         &record_slice, buffer_.data(), true /*for_compaction*/);
+  if (status_.ok() &&
+      ShouldVerifyBlobChecksum(titan_cf_options_, true /*for_compaction*/)) {
+    status_ = decoder_.VerifyChecksum(record_slice);
+  }
   if (status_.ok()) {
     status_ =
         decoder_.DecodeRecord(&record_slice, &cur_blob_record_, &uncompressed_);
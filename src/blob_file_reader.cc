@@ -4,7 +4,20 @@
 #define __STDC_FORMAT_MACROS
 #endif
 
+#include <fcntl.h>
 #include <inttypes.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+
+#ifdef TITAN_IOURING_PRESENT
+#include <errno.h>
+#include <liburing.h>
+#include <string.h>
+#include <sys/uio.h>
+#endif
 
 #include "file/filename.h"
 #include "test_util/sync_point.h"
@@ -36,8 +49,30 @@ Status NewBlobFileReader(uint64_t file_number, uint64_t readahead_size,
 
 const uint64_t kMaxReadaheadSize = 64 << 10;
 
+// Bytes at the end of a file read with direct I/O kept in memory, rounded
+// up to the sector size.
+const uint64_t kDirectReadTailSize = 4 << 10;
+
+// Upper bound of a single read issued by BlobFileReader::MultiGet when
+// coalescing neighbouring records.
+const uint64_t kMaxCoalescedReadSize = 1 << 20;
+
 namespace {
 
+// The buffer of a read of BlobFileReader::MultiGet, shared by the records
+// sliced out of it.
+struct SharedExtent {
+  CacheAllocationPtr data;
+  std::atomic<size_t> refs;
+
+  static void Unref(void* arg1, void* /*arg2*/) {
+    auto extent = reinterpret_cast<SharedExtent*>(arg1);
+    if (extent->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      delete extent;
+    }
+  }
+};
+
 void GenerateCachePrefix(std::string* dst, Cache* cc, RandomAccessFile* file) {
   char buffer[kMaxVarint64Length * 3 + 1];
   auto size = file->GetUniqueId(buffer, sizeof(buffer));
@@ -53,33 +88,217 @@ void EncodeBlobCache(std::string* dst, const Slice& prefix, uint64_t offset) {
   PutVarint64(dst, offset);
 }
 
+// Compresses a record evicted from the blob cache into "cache". Records
+// in it are prefixed by their compression type.
+void InsertCompressed(Cache* cache, const Slice& key, const Slice& blob,
+                      CompressionType compression) {
+  CompressionOptions opts;
+  CompressionContext ctx(compression);
+  CompressionInfo info(opts, ctx, CompressionDict::GetEmptyDict(),
+                       compression, 0 /*sample_for_compression*/);
+  std::string output;
+  CompressionType type = kNoCompression;
+  Slice compressed = Compress(info, blob, &output, &type);
+  if (type == kNoCompression) {
+    // It would take as much room as in the blob cache.
+    return;
+  }
+  CacheAllocationPtr buffer(new char[compressed.size() + 1]);
+  buffer[0] = static_cast<char>(type);
+  memcpy(buffer.get() + 1, compressed.data(), compressed.size());
+  auto value = new OwnedSlice;
+  value->reset(std::move(buffer), compressed.size() + 1);
+  cache->Insert(key, value, value->size() + sizeof(*value),
+                &DeleteCacheValue<OwnedSlice>);
+}
+
+// A record in the blob cache that moves to the compressed blob cache
+// when it is evicted.
+class DemotableBlob : public OwnedSlice {
+ public:
+  DemotableBlob(OwnedSlice&& blob, std::shared_ptr<Cache> compressed_cache,
+                CompressionType compression)
+      : OwnedSlice(std::move(blob)),
+        compressed_cache_(std::move(compressed_cache)),
+        compression_(compression) {}
+
+  static void Delete(const Slice& key, void* value) {
+    auto blob =
+        static_cast<DemotableBlob*>(reinterpret_cast<OwnedSlice*>(value));
+    InsertCompressed(blob->compressed_cache_.get(), key, *blob,
+                     blob->compression_);
+    delete blob;
+  }
+
+ private:
+  std::shared_ptr<Cache> compressed_cache_;
+  CompressionType compression_;
+};
+
+#ifdef TITAN_IOURING_PRESENT
+// Every thread owns a ring so that concurrent readers never contend on a
+// submission queue. The ring is created on first use, sized by the first
+// caller, and torn down when the thread exits or the ring fails.
+class ThreadIOUring {
+ public:
+  ~ThreadIOUring() { Reset(); }
+
+  static ThreadIOUring* Get(uint32_t depth) {
+    static thread_local ThreadIOUring uring;
+    if (uring.depth_ == 0 &&
+        io_uring_queue_init(depth, &uring.ring_, 0 /*flags*/) == 0) {
+      uring.depth_ = depth;
+    }
+    return uring.depth_ > 0 ? &uring : nullptr;
+  }
+
+  // Reads all requests through the ring. Returns false if the ring broke
+  // down, in which case requests with an empty result were not served.
+  bool Read(int fd, std::vector<BlobIORequest>* requests) {
+    size_t n = requests->size();
+    std::vector<struct iovec> iovs(n);
+    size_t next = 0;
+    size_t queued = 0;
+    size_t submitted = 0;
+    while (next < n || queued + submitted > 0) {
+      while (next < n && queued + submitted < depth_) {
+        struct io_uring_sqe* sqe = io_uring_get_sqe(&ring_);
+        if (sqe == nullptr) break;
+        auto& request = (*requests)[next];
+        iovs[next].iov_base = request.scratch;
+        iovs[next].iov_len = request.len;
+        // readv rather than read keeps kernels older than 5.6 working.
+        io_uring_prep_readv(sqe, fd, &iovs[next], 1, request.offset);
+        io_uring_sqe_set_data(sqe, &request);
+        next++;
+        queued++;
+      }
+      int ret = io_uring_submit_and_wait(&ring_, 1);
+      if (ret < 0 && ret != -EINTR && ret != -EAGAIN && ret != -EBUSY) {
+        // Queued entries never reached the kernel and die with the ring,
+        // but those in flight still write into the caller's buffers.
+        Drain(submitted);
+        Reset();
+        return false;
+      }
+      if (ret > 0) {
+        submitted += ret;
+        queued -= ret;
+      }
+      struct io_uring_cqe* cqe = nullptr;
+      while (submitted > 0 && io_uring_peek_cqe(&ring_, &cqe) == 0) {
+        Complete(cqe);
+        submitted--;
+      }
+    }
+    return true;
+  }
+
+ private:
+  void Complete(struct io_uring_cqe* cqe) {
+    auto request = static_cast<BlobIORequest*>(io_uring_cqe_get_data(cqe));
+    if (cqe->res < 0) {
+      request->status = Status::IOError("io_uring read", strerror(-cqe->res));
+    } else {
+      // A short read is reported by the caller's size check, the same
+      // way as a short pread.
+      request->result = Slice(request->scratch, cqe->res);
+    }
+    io_uring_cqe_seen(&ring_, cqe);
+  }
+
+  void Drain(size_t submitted) {
+    struct io_uring_cqe* cqe = nullptr;
+    while (submitted > 0) {
+      int ret = io_uring_wait_cqe(&ring_, &cqe);
+      if (ret == -EINTR) continue;
+      if (ret < 0) break;
+      Complete(cqe);
+      submitted--;
+    }
+  }
+
+  void Reset() {
+    if (depth_ > 0) {
+      io_uring_queue_exit(&ring_);
+      depth_ = 0;
+    }
+  }
+
+  struct io_uring ring_;
+  uint32_t depth_{0};
+};
+#endif  // TITAN_IOURING_PRESENT
+
 }  // namespace
 
 Status BlobFileReader::Open(const TitanCFOptions& options,
                             std::unique_ptr<RandomAccessFileReader> file,
                             uint64_t file_size,
                             std::unique_ptr<BlobFileReader>* result,
-                            TitanStats* stats) {
+                            TitanStats* stats, uint32_t io_queue_depth,
+                            bool verify_footer, bool mmap_reads,
+                            const BlobReadResources& resources) {
   if (file_size < BlobFileFooter::kEncodedLength) {
     return Status::Corruption("file is too short to be a blob file");
   }
 
-  FixedSlice<BlobFileFooter::kEncodedLength> buffer;
-  Status s = file->Read(file_size - BlobFileFooter::kEncodedLength,
-                        BlobFileFooter::kEncodedLength, &buffer, buffer.get());
-  if (!s.ok()) {
-    return s;
+  std::unique_ptr<BlobFileReader> reader(
+      new BlobFileReader(options, std::move(file), stats));
+  reader->resources_ = resources;
+  if (resources.flash_cache) {
+    char id[kMaxVarint64Length * 3 + 1];
+    size_t size = reader->file_->file()->GetUniqueId(id, sizeof(id));
+    reader->flash_prefix_.assign(id, size);
   }
-
-  BlobFileFooter footer;
-  s = DecodeInto(buffer, &footer);
-  if (!s.ok()) {
-    return s;
+  bool direct_io = reader->file_->use_direct_io();
+  if (direct_io) {
+    Status s = reader->LoadTail(file_size);
+    if (!s.ok()) {
+      return s;
+    }
+  }
+  if (verify_footer) {
+    FixedSlice<BlobFileFooter::kEncodedLength> buffer;
+    Status s =
+        reader->ReadAt(file_size - BlobFileFooter::kEncodedLength,
+                       BlobFileFooter::kEncodedLength, &buffer, buffer.get());
+    if (!s.ok()) {
+      return s;
+    }
+    s = DecodeInto(buffer, &reader->footer_);
+    if (!s.ok()) {
+      return s;
+    }
   }
 
-  auto reader = new BlobFileReader(options, std::move(file), stats);
-  reader->footer_ = footer;
-  result->reset(reader);
+#ifdef TITAN_IOURING_PRESENT
+  // Direct reads must be aligned, they are left to DirectRead.
+  if (io_queue_depth > 0 && !direct_io) {
+    // Failing to open is not fatal, batched reads then fall back to pread.
+    reader->fd_ =
+        open(reader->file_->file_name().c_str(), O_RDONLY | O_CLOEXEC);
+    reader->io_queue_depth_ = io_queue_depth;
+  }
+#else
+  (void)io_queue_depth;
+#endif
+  if (mmap_reads) {
+    // Failing to map is not fatal, reads then go through "file_".
+    int fd = open(reader->file_->file_name().c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+      void* base = mmap(nullptr, file_size, PROT_READ, MAP_SHARED, fd, 0);
+      close(fd);
+      if (base != MAP_FAILED) {
+        // Point lookups should fault in only the pages they touch, scans
+        // ask for more through Prefetch.
+        madvise(base, file_size, MADV_RANDOM);
+        reader->mmap_base_ = static_cast<const char*>(base);
+        reader->mmap_size_ = file_size;
+      }
+    }
+  }
+  result->reset(reader.release());
   return Status::OK();
 }
 
@@ -95,53 +314,571 @@ BlobFileReader::BlobFileReader(const TitanCFOptions& options,
   }
 }
 
-Status BlobFileReader::Get(const ReadOptions& /*options*/,
+BlobFileReader::~BlobFileReader() {
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+  if (mmap_base_ != nullptr) {
+    munmap(const_cast<char*>(mmap_base_), mmap_size_);
+  }
+}
+
+Status BlobFileReader::Get(const ReadOptions& options,
                            const BlobHandle& handle, BlobRecord* record,
-                           PinnableSlice* buffer) {
+                           PinnableSlice* buffer, uint64_t raw_value_size,
+                           bool for_compaction) {
   TEST_SYNC_POINT("BlobFileReader::Get");
 
   std::string cache_key;
-  Cache::Handle* cache_handle = nullptr;
   if (cache_) {
     EncodeBlobCache(&cache_key, cache_prefix_, handle.offset);
-    cache_handle = cache_->Lookup(cache_key);
-    if (cache_handle) {
-      // RecordTick(stats_, TitanStats::BLOB_CACHE_HIT);
-      auto blob = reinterpret_cast<OwnedSlice*>(cache_->Value(cache_handle));
-      buffer->PinSlice(*blob, UnrefCacheHandle, cache_.get(), cache_handle);
-      return DecodeInto(*blob, record);
+    Status s;
+    if (GetFromCache(cache_key, record, buffer, &s)) {
+      return s;
+    }
+  }
+  if (options.read_tier == kBlockCacheTier) {
+    return Status::Incomplete("blob not found in blob cache, no I/O allowed");
+  }
+  if (!flash_prefix_.empty()) {
+    Status s;
+    if (GetFromFlashCache(handle.offset, record, buffer, options.fill_cache,
+                          cache_key, &s)) {
+      return s;
     }
   }
-  // RecordTick(stats_, TitanStats::BLOB_CACHE_MISS);
 
+  // Only the value of a record stored with just its value can be cached,
+  // anything else must be read in full to be cached or verified.
+  bool verify_checksum = ShouldVerifyBlobChecksum(options_, for_compaction);
+  bool read_value = raw_value_size > 0 && !verify_checksum &&
+                    (record->only_value || !cache_ || !options.fill_cache);
   OwnedSlice blob;
-  Status s = ReadRecord(handle, record, &blob);
+  Status s = read_value
+                 ? ReadValue(handle, raw_value_size, record, &blob)
+                 : ReadRecord(handle, record, &blob, verify_checksum);
   if (!s.ok()) {
     return s;
   }
+  // Reads of GC and level merge don't tell about the hot records.
+  if (options.fill_cache && !for_compaction &&
+      (!read_value || record->only_value)) {
+    InsertIntoFlashCache(handle.offset, blob);
+  }
+  PinRecord(cache_key, &blob, buffer, options.fill_cache);
+  return Status::OK();
+}
+
+Status BlobFileReader::GetPartial(const ReadOptions& options,
+                                  const BlobHandle& handle,
+                                  uint64_t raw_value_size, bool only_value,
+                                  uint64_t offset, uint64_t len,
+                                  PinnableSlice* value) {
+  TEST_SYNC_POINT("BlobFileReader::GetPartial");
 
+  BlobRecord record;
+  record.only_value = only_value;
+  PinnableSlice buffer;
+  if (raw_value_size == 0 ||
+      ShouldVerifyBlobChecksum(options_, false /*for_compaction*/)) {
+    Status s = Get(options, handle, &record, &buffer);
+    if (s.ok()) {
+      PinPartialValue(record.value, offset, len, &buffer, value);
+    }
+    return s;
+  }
   if (cache_) {
-    auto cache_value = new OwnedSlice(std::move(blob));
-    auto cache_size = cache_value->size() + sizeof(*cache_value);
-    cache_->Insert(cache_key, cache_value, cache_size,
-                   &DeleteCacheValue<OwnedSlice>, &cache_handle);
+    std::string cache_key;
+    EncodeBlobCache(&cache_key, cache_prefix_, handle.offset);
+    Status s;
+    if (GetFromCache(cache_key, &record, &buffer, &s)) {
+      if (s.ok()) {
+        PinPartialValue(record.value, offset, len, &buffer, value);
+      }
+      return s;
+    }
+  }
+  if (options.read_tier == kBlockCacheTier) {
+    return Status::Incomplete("blob not found in blob cache, no I/O allowed");
+  }
+
+  // The value makes up the last "raw_value_size" bytes of the record.
+  if (raw_value_size + kRecordHeaderSize > handle.size) {
+    return Status::Corruption("value size " + ToString(raw_value_size) +
+                              " exceeds blob size " + ToString(handle.size));
+  }
+  uint64_t begin = std::min(offset, raw_value_size);
+  uint64_t size = std::min(len, raw_value_size - begin);
+  value->Reset();
+  if (size == 0) {
+    return Status::OK();
+  }
+  Slice result;
+  CacheAllocationPtr ubuf;
+  Status s = Read(handle.offset + handle.size - raw_value_size + begin, size,
+                  &result, &ubuf);
+  if (!s.ok()) {
+    return s;
+  }
+  if (result.size() != size) {
+    return Status::Corruption(
+        "GetPartial actual size: " + ToString(result.size()) +
+        " not equal to requested size " + ToString(size));
+  }
+  if (ubuf) {
+    value->PinSlice(result, OwnedSlice::CleanupFunc, ubuf.release(), nullptr);
+  } else {
+    Cleanable mapping;
+    value->PinSlice(result, &mapping);
+  }
+  return s;
+}
+
+void BlobFileReader::MultiGet(const ReadOptions& options,
+                              const std::vector<BlobGetRequest*>& requests,
+                              uint64_t max_gap) {
+  TEST_SYNC_POINT("BlobFileReader::MultiGet");
+
+  struct Miss {
+    BlobGetRequest* request;
+    std::string cache_key;
+  };
+  std::vector<Miss> misses;
+  misses.reserve(requests.size());
+  for (auto* request : requests) {
+    std::string cache_key;
+    if (cache_) {
+      EncodeBlobCache(&cache_key, cache_prefix_, request->handle.offset);
+      if (GetFromCache(cache_key, request->record, request->buffer,
+                       &request->status)) {
+        continue;
+      }
+    }
+    if (options.read_tier == kBlockCacheTier) {
+      request->status =
+          Status::Incomplete("blob not found in blob cache, no I/O allowed");
+      continue;
+    }
+    if (!flash_prefix_.empty() &&
+        GetFromFlashCache(request->handle.offset, request->record,
+                          request->buffer, options.fill_cache, cache_key,
+                          &request->status)) {
+      continue;
+    }
+    misses.push_back(Miss{request, std::move(cache_key)});
+  }
+  if (mmap_base_ != nullptr) {
+    // Nothing to batch, a mapped file is read in place.
+    bool verify_checksum =
+        ShouldVerifyBlobChecksum(options_, false /*for_compaction*/);
+    for (auto& miss : misses) {
+      OwnedSlice blob;
+      miss.request->status = ReadRecord(
+          miss.request->handle, miss.request->record, &blob, verify_checksum);
+      if (miss.request->status.ok()) {
+        if (options.fill_cache) {
+          InsertIntoFlashCache(miss.request->handle.offset, blob);
+        }
+        PinRecord(miss.cache_key, &blob, miss.request->buffer,
+                  options.fill_cache);
+      }
+    }
+    return;
+  }
+  std::sort(misses.begin(), misses.end(), [](const Miss& a, const Miss& b) {
+    return a.request->handle.offset < b.request->handle.offset;
+  });
+
+  // Splits the misses into extents, [begin, end) of "misses" each.
+  std::vector<std::pair<size_t, size_t>> extents;
+  std::vector<BlobIORequest> reads;
+  std::vector<CacheAllocationPtr> scratches;
+  size_t begin = 0;
+  while (begin < misses.size()) {
+    // Extends the extent as long as the next record is close enough.
+    const BlobHandle& first = misses[begin].request->handle;
+    uint64_t extent_begin = first.offset;
+    uint64_t extent_end = first.offset + first.size;
+    size_t end = begin + 1;
+    for (; end < misses.size(); end++) {
+      const BlobHandle& next = misses[end].request->handle;
+      uint64_t next_end = std::max(extent_end, next.offset + next.size);
+      if (next.offset > extent_end + max_gap ||
+          next_end - extent_begin > kMaxCoalescedReadSize) {
+        break;
+      }
+      extent_end = next_end;
+    }
+    BlobIORequest read;
+    read.offset = extent_begin;
+    read.len = extent_end - extent_begin;
+    scratches.emplace_back(new char[read.len]);
+    read.scratch = scratches.back().get();
+    reads.push_back(read);
+    extents.emplace_back(begin, end);
+    begin = end;
+  }
+
+  MultiRead(&reads);
+
+  for (size_t e = 0; e < extents.size(); e++) {
+    const BlobIORequest& read = reads[e];
+    Status s = read.status;
+    if (s.ok() && read.result.size() != read.len) {
+      s = Status::Corruption("MultiGet actual size: " +
+                             ToString(read.result.size()) +
+                             " not equal to extent size " +
+                             ToString(read.len));
+    }
+    // Records of an extent point into its buffer rather than being copied
+    // out. The buffer lives as long as one of them is pinned; records that
+    // get cached are copied into the cache by PinRecord.
+    SharedExtent* extent = nullptr;
+    if (s.ok() && extents[e].second - extents[e].first > 1 &&
+        read.result.data() == read.scratch) {
+      extent = new SharedExtent{std::move(scratches[e]), {1}};
+    }
+    for (size_t i = extents[e].first; i < extents[e].second; i++) {
+      auto& miss = misses[i];
+      if (!s.ok()) {
+        miss.request->status = s;
+        continue;
+      }
+      const BlobHandle& handle = miss.request->handle;
+      const char* data = read.result.data() + (handle.offset - read.offset);
+      CacheAllocationPtr ubuf;
+      if (extents[e].second - extents[e].first == 1) {
+        ubuf = std::move(scratches[e]);
+      } else if (extent == nullptr) {
+        ubuf.reset(new char[handle.size]);
+        memcpy(ubuf.get(), data, handle.size);
+        data = ubuf.get();
+      }
+      Slice raw(data, handle.size);
+      OwnedSlice blob;
+      miss.request->status = DecodeRecord(
+          handle, std::move(ubuf), raw, miss.request->record, &blob,
+          ShouldVerifyBlobChecksum(options_, false /*for_compaction*/));
+      if (miss.request->status.ok()) {
+        if (options.fill_cache) {
+          InsertIntoFlashCache(handle.offset, blob);
+        }
+        Cleanable owner;
+        if (extent != nullptr) {
+          extent->refs.fetch_add(1, std::memory_order_relaxed);
+          owner.RegisterCleanup(&SharedExtent::Unref, extent, nullptr);
+        }
+        PinRecord(miss.cache_key, &blob, miss.request->buffer,
+                  options.fill_cache, &owner);
+        if (extent != nullptr) {
+          // A cached record is a copy, the extent may go away.
+          miss.request->status =
+              DecodeInto(*miss.request->buffer, miss.request->record);
+        }
+      }
+    }
+    if (extent != nullptr) {
+      SharedExtent::Unref(extent, nullptr);
+    }
+  }
+}
+
+void BlobFileReader::MultiRead(std::vector<BlobIORequest>* requests) {
+#ifdef TITAN_IOURING_PRESENT
+  if (fd_ >= 0 && requests->size() > 1) {
+    ThreadIOUring* uring = ThreadIOUring::Get(io_queue_depth_);
+    if (uring != nullptr && uring->Read(fd_, requests)) {
+      return;
+    }
+  }
+#endif
+  for (auto& request : *requests) {
+    if (!request.status.ok() || !request.result.empty()) {
+      continue;
+    }
+    request.status = ReadAt(request.offset, request.len, &request.result,
+                            request.scratch);
+  }
+}
+
+bool BlobFileReader::GetFromCache(const std::string& cache_key,
+                                  BlobRecord* record, PinnableSlice* buffer,
+                                  Status* s) {
+  Cache::Handle* cache_handle = cache_->Lookup(cache_key);
+  if (cache_handle) {
+    RecordCacheTick(TitanStats::BLOB_CACHE_HIT);
+  } else {
+    OwnedSlice blob;
+    if (options_.blob_compressed_cache &&
+        GetFromCompressedCache(cache_key, &blob)) {
+      cache_handle = InsertIntoCache(cache_key, &blob);
+    }
+    if (!cache_handle) {
+      RecordCacheTick(TitanStats::BLOB_CACHE_MISS);
+      return false;
+    }
+    RecordCacheTick(TitanStats::BLOB_COMPRESSED_CACHE_HIT);
+  }
+  if (resources_.admission) {
+    resources_.admission->RecordAccess(cache_key);
+  }
+  auto blob = reinterpret_cast<OwnedSlice*>(cache_->Value(cache_handle));
+  buffer->PinSlice(*blob, UnrefCacheHandle, cache_.get(), cache_handle);
+  *s = DecodeInto(*blob, record);
+  return true;
+}
+
+void BlobFileReader::PinRecord(const std::string& cache_key, OwnedSlice* blob,
+                               PinnableSlice* buffer, bool fill_cache,
+                               Cleanable* owner) {
+  bool admit = cache_ && fill_cache;
+  if (admit && resources_.admission &&
+      !resources_.admission->Admit(cache_key,
+                                   blob->size() + sizeof(OwnedSlice))) {
+    admit = false;
+    RecordCacheTick(TitanStats::BLOB_CACHE_ADMISSION_REJECT);
+  }
+  if (admit) {
+    if (!blob->owned()) {
+      // The cache entry may outlive the mapping.
+      CacheAllocationPtr copy(new char[blob->size()]);
+      memcpy(copy.get(), blob->data(), blob->size());
+      blob->reset(std::move(copy), blob->size());
+    }
+    Cache::Handle* cache_handle = InsertIntoCache(cache_key, blob);
+    auto cache_value =
+        reinterpret_cast<OwnedSlice*>(cache_->Value(cache_handle));
     buffer->PinSlice(*cache_value, UnrefCacheHandle, cache_.get(),
                      cache_handle);
+  } else if (blob->owned()) {
+    Slice data = *blob;
+    buffer->PinSlice(data, OwnedSlice::CleanupFunc, blob->release(), nullptr);
+  } else if (owner != nullptr) {
+    buffer->PinSlice(*blob, owner);
   } else {
-    buffer->PinSlice(blob, OwnedSlice::CleanupFunc, blob.release(), nullptr);
+    Cleanable mapping;
+    buffer->PinSlice(*blob, &mapping);
   }
+}
 
-  return Status::OK();
+Cache::Handle* BlobFileReader::InsertIntoCache(const std::string& cache_key,
+                                               OwnedSlice* blob) {
+  OwnedSlice* cache_value = nullptr;
+  void (*deleter)(const Slice&, void*) = nullptr;
+  if (options_.blob_compressed_cache) {
+    cache_value = new DemotableBlob(std::move(*blob),
+                                    options_.blob_compressed_cache,
+                                    options_.blob_compressed_cache_compression);
+    deleter = &DemotableBlob::Delete;
+  } else {
+    cache_value = new OwnedSlice(std::move(*blob));
+    deleter = &DeleteCacheValue<OwnedSlice>;
+  }
+  Cache::Handle* cache_handle = nullptr;
+  cache_->Insert(cache_key, cache_value,
+                 cache_value->size() + sizeof(*cache_value), deleter,
+                 &cache_handle);
+  return cache_handle;
+}
+
+bool BlobFileReader::GetFromCompressedCache(const std::string& cache_key,
+                                            OwnedSlice* blob) {
+  Cache* compressed_cache = options_.blob_compressed_cache.get();
+  Cache::Handle* cache_handle = compressed_cache->Lookup(cache_key);
+  if (!cache_handle) {
+    return false;
+  }
+  auto compressed =
+      reinterpret_cast<OwnedSlice*>(compressed_cache->Value(cache_handle));
+  auto type = static_cast<CompressionType>((*compressed)[0]);
+  UncompressionContext ctx(type);
+  UncompressionInfo info(ctx, UncompressionDict::GetEmptyDict(), type);
+  Status s = Uncompress(
+      info, Slice(compressed->data() + 1, compressed->size() - 1), blob);
+  compressed_cache->Release(cache_handle);
+  if (!s.ok()) {
+    return false;
+  }
+  // The record moves back into the blob cache.
+  compressed_cache->Erase(cache_key);
+  return true;
+}
+
+bool BlobFileReader::GetFromFlashCache(uint64_t offset, BlobRecord* record,
+                                       PinnableSlice* buffer, bool fill_cache,
+                                       const std::string& cache_key,
+                                       Status* s) {
+  std::string flash_key;
+  EncodeBlobCache(&flash_key, flash_prefix_, offset);
+  OwnedSlice blob;
+  if (!resources_.flash_cache->Lookup(flash_key, &blob)) {
+    RecordCacheTick(TitanStats::BLOB_FLASH_CACHE_MISS);
+    return false;
+  }
+  RecordCacheTick(TitanStats::BLOB_FLASH_CACHE_HIT);
+  PinRecord(cache_key, &blob, buffer, fill_cache);
+  *s = DecodeInto(*buffer, record);
+  return true;
+}
+
+void BlobFileReader::InsertIntoFlashCache(uint64_t offset, const Slice& blob) {
+  if (flash_prefix_.empty()) {
+    return;
+  }
+  std::string flash_key;
+  EncodeBlobCache(&flash_key, flash_prefix_, offset);
+  resources_.flash_cache->Insert(flash_key, blob);
+}
+
+void BlobFileReader::RecordCacheTick(uint32_t ticker) {
+  if (stats_) {
+    stats_->recordTick(ticker, 1);
+  }
+}
+
+Status BlobFileReader::Read(uint64_t offset, size_t n, Slice* result,
+                            CacheAllocationPtr* scratch) {
+  if (mmap_base_ != nullptr) {
+    if (offset + n > mmap_size_) {
+      return Status::Corruption("read of " + ToString(n) + " bytes at " +
+                                ToString(offset) + " beyond end of " +
+                                file_->file_name());
+    }
+    *result = Slice(mmap_base_ + offset, n);
+    return Status::OK();
+  }
+  scratch->reset(new char[n]);
+  return ReadAt(offset, n, result, scratch->get());
+}
+
+Status BlobFileReader::ReadAt(uint64_t offset, size_t n, Slice* result,
+                              char* scratch) {
+  if (tail_size_ > 0 && offset >= tail_offset_) {
+    uint64_t begin = std::min<uint64_t>(offset - tail_offset_, tail_size_);
+    size_t size =
+        static_cast<size_t>(std::min<uint64_t>(n, tail_size_ - begin));
+    memcpy(scratch, tail_.BufferStart() + begin, size);
+    *result = Slice(scratch, size);
+    return Status::OK();
+  }
+  if (file_->use_direct_io()) {
+    return DirectRead(offset, n, result, scratch);
+  }
+  return file_->Read(offset, n, result, scratch);
+}
+
+Status BlobFileReader::DirectRead(uint64_t offset, size_t n, Slice* result,
+                                  char* scratch) {
+  size_t alignment = file_->file()->GetRequiredBufferAlignment();
+  uint64_t begin = TruncateToPageBoundary(alignment, offset);
+  size_t size = Roundup(offset + n, alignment) - begin;
+  AlignedBuffer buffer;
+  if (resources_.buffer_pool) {
+    resources_.buffer_pool->Acquire(alignment, size, &buffer);
+  } else {
+    buffer.Alignment(alignment);
+    buffer.AllocateNewBuffer(size);
+  }
+  Slice aligned;
+  Status s = file_->file()->Read(begin, size, &aligned, buffer.BufferStart());
+  if (s.ok()) {
+    if (stats_) {
+      stats_->recordTick(TitanStats::BLOB_DIRECT_READ_BYTES, n);
+      stats_->recordTick(TitanStats::BLOB_DIRECT_READ_ALIGNED_BYTES, size);
+    }
+    // A read at the end of the file comes back short.
+    uint64_t skip = std::min<uint64_t>(offset - begin, aligned.size());
+    size_t copy = static_cast<size_t>(
+        std::min<uint64_t>(n, aligned.size() - skip));
+    memcpy(scratch, aligned.data() + skip, copy);
+    *result = Slice(scratch, copy);
+  }
+  if (resources_.buffer_pool) {
+    resources_.buffer_pool->Release(std::move(buffer));
+  }
+  return s;
+}
+
+Status BlobFileReader::LoadTail(uint64_t file_size) {
+  size_t alignment = file_->file()->GetRequiredBufferAlignment();
+  uint64_t begin = TruncateToPageBoundary(
+      alignment, file_size - std::min(file_size, kDirectReadTailSize));
+  size_t size = Roundup(file_size - begin, alignment);
+  tail_.Alignment(alignment);
+  tail_.AllocateNewBuffer(size);
+  Slice result;
+  Status s = file_->file()->Read(begin, size, &result, tail_.BufferStart());
+  if (!s.ok()) {
+    return s;
+  }
+  if (result.size() != file_size - begin) {
+    return Status::Corruption("LoadTail actual size: " +
+                              ToString(result.size()) +
+                              " not equal to expected size " +
+                              ToString(file_size - begin));
+  }
+  tail_offset_ = begin;
+  tail_size_ = result.size();
+  return s;
+}
+
+void BlobFileReader::Prefetch(uint64_t offset, size_t n) {
+  TEST_SYNC_POINT_CALLBACK("BlobFileReader::Prefetch", &offset);
+  if (mmap_base_ == nullptr) {
+    file_->Prefetch(offset, n);
+    return;
+  }
+  if (offset >= mmap_size_) {
+    return;
+  }
+  static const uint64_t kPageSize = sysconf(_SC_PAGESIZE);
+  // The mapping starts on a page boundary, madvise wants one too.
+  uint64_t begin = offset / kPageSize * kPageSize;
+  uint64_t end = std::min(mmap_size_, offset + n);
+  madvise(const_cast<char*>(mmap_base_) + begin, end - begin, MADV_WILLNEED);
 }
 
 Status BlobFileReader::ReadRecord(const BlobHandle& handle, BlobRecord* record,
-                                  OwnedSlice* buffer) {
+                                  OwnedSlice* buffer, bool verify_checksum) {
   Slice blob;
-  CacheAllocationPtr ubuf(new char[handle.size]);
-  Status s = file_->Read(handle.offset, handle.size, &blob, ubuf.get());
+  CacheAllocationPtr ubuf;
+  Status s = Read(handle.offset, handle.size, &blob, &ubuf);
   if (!s.ok()) {
     return s;
   }
+  return DecodeRecord(handle, std::move(ubuf), blob, record, buffer,
+                      verify_checksum);
+}
+
+Status BlobFileReader::ReadValue(const BlobHandle& handle,
+                                 uint64_t value_size, BlobRecord* record,
+                                 OwnedSlice* buffer) {
+  if (value_size + kRecordHeaderSize > handle.size) {
+    return Status::Corruption("value size " + ToString(value_size) +
+                              " exceeds blob size " + ToString(handle.size));
+  }
+  Slice blob;
+  CacheAllocationPtr ubuf;
+  Status s =
+      Read(handle.offset + handle.size - value_size, value_size, &blob, &ubuf);
+  if (!s.ok()) {
+    return s;
+  }
+  if (blob.size() != value_size) {
+    return Status::Corruption(
+        "ReadValue actual size: " + ToString(blob.size()) +
+        " not equal to value size " + ToString(value_size));
+  }
+  buffer->reset(std::move(ubuf), blob);
+  record->key = Slice();
+  record->value = *buffer;
+  return s;
+}
+
+Status BlobFileReader::DecodeRecord(const BlobHandle& handle,
+                                    CacheAllocationPtr ubuf, Slice blob,
+                                    BlobRecord* record, OwnedSlice* buffer,
+                                    bool verify_checksum) {
   if (handle.size != static_cast<uint64_t>(blob.size())) {
     return Status::Corruption(
         "ReadRecord actual size: " + ToString(blob.size()) +
@@ -149,17 +886,23 @@ Status BlobFileReader::ReadRecord(const BlobHandle& handle, BlobRecord* record,
   }
 
   BlobDecoder decoder;
-  s = decoder.DecodeHeader(&blob);
+  Status s = decoder.DecodeHeader(&blob);
   if (!s.ok()) {
     return s;
   }
+  if (verify_checksum) {
+    s = decoder.VerifyChecksum(blob, stats_);
+    if (!s.ok()) {
+      return s;
+    }
+  }
   buffer->reset(std::move(ubuf), blob);
   s = decoder.DecodeRecord(&blob, record, buffer);
   return s;
 }
 
 void BlobFilePrefetcher::Prefetch(const BlobHandle& handle){
-  reader_->file_->Prefetch(handle.offset, handle.size);
+  reader_->Prefetch(handle.offset, handle.size);
 }
 
 Status BlobFilePrefetcher::PointGet(const ReadOptions& options, const BlobHandle& handle, BlobRecord* record, PinnableSlice* buffer) {
@@ -167,7 +910,8 @@ Status BlobFilePrefetcher::PointGet(const ReadOptions& options, const BlobHandle
     record->only_value = true;
   else
     record->only_value = false;
-  return reader_->Get(options, handle, record, buffer);
+  return reader_->Get(options, handle, record, buffer, 0 /*raw_value_size*/,
+                      for_compaction_);
 }
 
 Status BlobFilePrefetcher::Get(const ReadOptions& options,
@@ -177,21 +921,43 @@ Status BlobFilePrefetcher::Get(const ReadOptions& options,
     record->only_value = true;
   else
     record->only_value = false;
+  uint64_t end = handle.offset + handle.size;
   if (handle.offset == last_offset_) {
-    last_offset_ = handle.offset + handle.size;
-    if (handle.offset + handle.size > readahead_limit_) {
+    if (readahead_begin_ != kNoReadahead) {
+      // Turned around.
+      readahead_size_ = 0;
+      readahead_begin_ = kNoReadahead;
+    }
+    if (end > readahead_limit_) {
       readahead_size_ = std::max(handle.size, readahead_size_);
-      reader_->file_->Prefetch(handle.offset, readahead_size_);
+      reader_->Prefetch(handle.offset, readahead_size_);
       readahead_limit_ = handle.offset + readahead_size_;
       readahead_size_ = std::min(kMaxReadaheadSize, readahead_size_ * 2);
     }
+  } else if (end == last_begin_) {
+    // Going backward, e.g. Prev() over a sorted file, reads ahead the
+    // region before the record.
+    if (readahead_limit_ != 0) {
+      readahead_size_ = 0;
+      readahead_limit_ = 0;
+    }
+    if (handle.offset < readahead_begin_) {
+      readahead_size_ = std::max(handle.size, readahead_size_);
+      uint64_t begin = end > readahead_size_ ? end - readahead_size_ : 0;
+      reader_->Prefetch(begin, static_cast<size_t>(end - begin));
+      readahead_begin_ = begin;
+      readahead_size_ = std::min(kMaxReadaheadSize, readahead_size_ * 2);
+    }
   } else {
-    last_offset_ = handle.offset + handle.size;
     readahead_size_ = 0;
     readahead_limit_ = 0;
+    readahead_begin_ = kNoReadahead;
   }
+  last_begin_ = handle.offset;
+  last_offset_ = end;
 
-  return reader_->Get(options, handle, record, buffer);
+  return reader_->Get(options, handle, record, buffer, 0 /*raw_value_size*/,
+                      for_compaction_);
 }
 
 }  // namespace titandb
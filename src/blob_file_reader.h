@@ -1,5 +1,9 @@
 #pragma once
 
+#include <limits>
+
+#include "blob_cache_admission.h"
+#include "blob_flash_cache.h"
 #include "blob_format.h"
 #include "titan/options.h"
 #include "titan_stats.h"
@@ -13,21 +17,94 @@ Status NewBlobFileReader(uint64_t file_number, uint64_t readahead_size,
                          const EnvOptions& env_options, Env* env,
                          std::unique_ptr<RandomAccessFileReader>* result);
 
+// A single lookup of a batched read. On return "record" and "buffer" are
+// filled the same way BlobFileReader::Get fills them, and "status" holds
+// the result of this lookup.
+struct BlobGetRequest {
+  BlobHandle handle;
+  BlobRecord* record{nullptr};
+  PinnableSlice* buffer{nullptr};
+  Status status;
+};
+
+// A raw read of "len" bytes at "offset" into "scratch", issued as part of
+// a batch by BlobFileReader::MultiRead.
+struct BlobIORequest {
+  uint64_t offset{0};
+  size_t len{0};
+  char* scratch{nullptr};
+  Slice result;
+  Status status;
+};
+
+// Objects shared by the readers of a column family, all optional.
+struct BlobReadResources {
+  // Aligned buffers for direct reads.
+  std::shared_ptr<AlignedBufferPool> buffer_pool;
+  // Decides which records go into the blob cache.
+  std::shared_ptr<BlobCacheAdmission> admission;
+  // Persistent cache checked after the blob cache.
+  std::shared_ptr<BlobFlashCache> flash_cache;
+};
+
 class BlobFileReader {
  public:
   // Opens a blob file and read the necessary metadata from it.
   // If successful, sets "*result" to the newly opened file reader.
+  // A non-zero "io_queue_depth" lets batched reads go through io_uring
+  // when it is available, see TitanDBOptions::blob_io_uring_queue_depth.
+  // Without "verify_footer" the footer is not read; the caller must have
+  // made sure the file is complete, e.g. through the manifest.
+  // With "mmap_reads" the file is read through a memory mapping if it
+  // can be mapped, see mmapped(). Reads use what "resources" provide.
   static Status Open(const TitanCFOptions& options,
                      std::unique_ptr<RandomAccessFileReader> file,
                      uint64_t file_size,
                      std::unique_ptr<BlobFileReader>* result,
-                     TitanStats* stats);
+                     TitanStats* stats, uint32_t io_queue_depth = 0,
+                     bool verify_footer = true, bool mmap_reads = false,
+                     const BlobReadResources& resources = BlobReadResources());
+
+  ~BlobFileReader();
+
+  // Returns true if the file is read through a memory mapping. Records
+  // read from a mapped file are not copied unless they are compressed or
+  // inserted into the blob cache, so they may point into the mapping and
+  // stay valid only as long as this reader.
+  bool mmapped() const { return mmap_base_ != nullptr; }
 
   // Gets the blob record pointed by the handle in this file. The data
   // of the record is stored in the provided buffer, so the buffer
-  // must be valid when the record is used.
+  // must be valid when the record is used. Honors "fill_cache", and
+  // returns Incomplete on a blob cache miss with kBlockCacheTier.
+  // A non-zero "raw_value_size", see BlobIndex::RawValueSize, lets a miss
+  // read only the value bytes when the whole record need not be cached;
+  // the key of the record is then left empty. Records are verified as
+  // TitanCFOptions::blob_checksum_policy says, "for_compaction" telling
+  // reads of GC and level merge apart.
   Status Get(const ReadOptions& options, const BlobHandle& handle,
-             BlobRecord* record, PinnableSlice* buffer);
+             BlobRecord* record, PinnableSlice* buffer,
+             uint64_t raw_value_size = 0, bool for_compaction = false);
+
+  // Gets up to "len" bytes of the value of the record pointed by the handle
+  // starting at "offset". A record found in the blob cache is served from
+  // there. Otherwise, if "raw_value_size" is non-zero and no checksum has
+  // to be verified, only the requested bytes are read and nothing is
+  // cached; else the whole record is read as Get does. "only_value" tells
+  // how the record is encoded, see BlobRecord.
+  Status GetPartial(const ReadOptions& options, const BlobHandle& handle,
+                    uint64_t raw_value_size, bool only_value, uint64_t offset,
+                    uint64_t len, PinnableSlice* value);
+
+  // Gets the blob records of a batch of requests against this file.
+  // Records missing from the blob cache are sorted by offset and those no
+  // more than "max_gap" bytes apart are fetched with a single read. All
+  // reads of the batch are submitted together, see MultiRead. Records not
+  // cached are sliced out of the buffer of their read, which is freed once
+  // all of them are released.
+  void MultiGet(const ReadOptions& options,
+                const std::vector<BlobGetRequest*>& requests,
+                uint64_t max_gap);
 
  private:
   friend class BlobFilePrefetcher;
@@ -36,14 +113,102 @@ class BlobFileReader {
                  std::unique_ptr<RandomAccessFileReader> file,
                  TitanStats* stats);
 
+  // Reads "n" bytes at "offset". A mapped file is read in place,
+  // otherwise the bytes go into "*scratch", which is allocated here.
+  Status Read(uint64_t offset, size_t n, Slice* result,
+              CacheAllocationPtr* scratch);
+
+  // Reads "n" bytes at "offset" into "scratch" from the file, or from the
+  // tail of the file kept in memory.
+  Status ReadAt(uint64_t offset, size_t n, Slice* result, char* scratch);
+
+  // Reads with direct I/O, rounding the read to sector boundaries.
+  Status DirectRead(uint64_t offset, size_t n, Slice* result, char* scratch);
+
+  // Keeps the last sectors of a file read with direct I/O in memory, so
+  // that the footer and the records at the end don't need aligned reads.
+  Status LoadTail(uint64_t file_size);
+
+  // Hints that "n" bytes at "offset" are about to be read.
+  void Prefetch(uint64_t offset, size_t n);
+
   Status ReadRecord(const BlobHandle& handle, BlobRecord* record,
-                    OwnedSlice* buffer);
+                    OwnedSlice* buffer, bool verify_checksum);
+
+  // Reads the last "value_size" bytes of the uncompressed record as its
+  // value, skipping the record header and the key.
+  Status ReadValue(const BlobHandle& handle, uint64_t value_size,
+                   BlobRecord* record, OwnedSlice* buffer);
+
+  // Issues a batch of reads. With io_uring they are all in flight at once,
+  // up to the configured queue depth, and reaped as they complete;
+  // otherwise they are served one by one with pread.
+  void MultiRead(std::vector<BlobIORequest>* requests);
+
+  // Decodes the record held in "ubuf" and makes "buffer" own it,
+  // verifying its checksum first if "verify_checksum" is set.
+  Status DecodeRecord(const BlobHandle& handle, CacheAllocationPtr ubuf,
+                      Slice blob, BlobRecord* record, OwnedSlice* buffer,
+                      bool verify_checksum);
+
+  // Looks up the record in the flash cache. On a hit, fills "record" and
+  // "buffer" and returns true, moving the record into the blob cache if
+  // "fill_cache" is set.
+  bool GetFromFlashCache(uint64_t offset, BlobRecord* record,
+                         PinnableSlice* buffer, bool fill_cache,
+                         const std::string& cache_key, Status* s);
+
+  // Offers a record read from the file to the flash cache.
+  void InsertIntoFlashCache(uint64_t offset, const Slice& blob);
+
+  // Looks up the record in the blob cache, then in the compressed blob
+  // cache. Returns true and fills "record" and "buffer" on a hit; a record
+  // found compressed is moved into the blob cache first.
+  bool GetFromCache(const std::string& cache_key, BlobRecord* record,
+                    PinnableSlice* buffer, Status* s);
+
+  // Inserts "blob" into the blob cache, and returns the handle of the
+  // entry. Records are demoted to the compressed blob cache on eviction
+  // if there is one.
+  Cache::Handle* InsertIntoCache(const std::string& cache_key,
+                                 OwnedSlice* blob);
+
+  // Looks up and uncompresses a record of the compressed blob cache into
+  // "blob", removing it from there.
+  bool GetFromCompressedCache(const std::string& cache_key, OwnedSlice* blob);
+
+  void RecordCacheTick(uint32_t ticker);
+
+  // Pins the freshly read record into "buffer", inserting it into the
+  // blob cache if there is one, "fill_cache" is set and it is admitted. A
+  // record that points into the mapping is copied before it is cached. The
+  // cleanups of "owner", if any, are handed to "buffer" along with a
+  // record that points into memory "owner" keeps alive.
+  void PinRecord(const std::string& cache_key, OwnedSlice* blob,
+                 PinnableSlice* buffer, bool fill_cache,
+                 Cleanable* owner = nullptr);
 
   TitanCFOptions options_;
   std::unique_ptr<RandomAccessFileReader> file_;
+  // Descriptor of the same file used for io_uring submissions, -1 if
+  // batched reads go through "file_".
+  int fd_{-1};
+  uint32_t io_queue_depth_{0};
+  // The whole file mapped read-only, null if it is read through "file_".
+  const char* mmap_base_{nullptr};
+  uint64_t mmap_size_{0};
+  BlobReadResources resources_;
+  // The tail of a file read with direct I/O, starting at "tail_offset_".
+  AlignedBuffer tail_;
+  uint64_t tail_offset_{0};
+  size_t tail_size_{0};
 
   std::shared_ptr<Cache> cache_;
   std::string cache_prefix_;
+  // Prefix of the flash cache keys of this file, stable across restarts.
+  // Empty if the file has no stable identity, which rules out the flash
+  // cache.
+  std::string flash_prefix_;
 
   // Information read from the file.
   BlobFileFooter footer_;
@@ -55,7 +220,8 @@ class BlobFileReader {
 class BlobFilePrefetcher : public Cleanable {
  public:
   // Constructs a prefetcher with the blob file reader.
-  // "*reader" must be valid when the prefetcher is used.
+  // "*reader" must be valid when the prefetcher is used, and as long as
+  // records read from a mapped file are used.
   BlobFilePrefetcher(BlobFileReader* reader, bool ov = false)
       : reader_(reader), only_value_(ov) {}
 
@@ -64,14 +230,28 @@ class BlobFilePrefetcher : public Cleanable {
 
   void Prefetch(const BlobHandle& handle);
 
+  // Marks the reads as done on behalf of level merge, which are verified
+  // like GC reads.
+  void SetForCompaction(bool for_compaction) {
+    for_compaction_ = for_compaction;
+  }
+
   Status PointGet(const ReadOptions& options, const BlobHandle& handle, BlobRecord* record, PinnableSlice* buffer);
 
  private:
+  static const uint64_t kNoReadahead = std::numeric_limits<uint64_t>::max();
+
   BlobFileReader* reader_;
+  // The start and the end of the record read last.
+  uint64_t last_begin_{0};
   uint64_t last_offset_{0};
   uint64_t readahead_size_{0};
+  // End of the region read ahead going forward.
   uint64_t readahead_limit_{0};
+  // Start of the region read ahead going backward.
+  uint64_t readahead_begin_{kNoReadahead};
   bool only_value_{false};
+  bool for_compaction_{false};
 };
 
 }  // namespace titandb
@@ -2,6 +2,12 @@
 
 #include <inttypes.h>
 
+#include <algorithm>
+#include <map>
+#include <thread>
+
+#include "rocksdb/rate_limiter.h"
+
 #include "edit_collector.h"
 
 namespace rocksdb {
@@ -9,25 +15,56 @@ namespace titandb {
 
 const size_t kMaxFileCacheSize = 1024 * 1024;
 
+namespace {
+
+// Warm-up reads cover at most this many bytes of a file each, and fetch
+// records up to this far apart with one I/O.
+const uint64_t kWarmUpBatchSize = 1 << 20;
+const uint64_t kWarmUpReadGap = 64 << 10;
+
+std::string HotBlobsFileName(const std::string& dirname) {
+  return dirname + "/HOT_BLOBS";
+}
+
+}  // namespace
+
 BlobFileSet::BlobFileSet(const TitanDBOptions& options, TitanStats* stats)
     : dirname_(options.dirname),
       env_(options.env),
       env_options_(options),
       db_options_(options),
-      stats_(stats) {
-  auto file_cache_size = db_options_.max_open_files;
+      stats_(stats),
+      storage_view_(new StorageMap()) {
+  auto file_cache_size = db_options_.max_open_blob_files != 0
+                             ? db_options_.max_open_blob_files
+                             : db_options_.max_open_files;
   if (file_cache_size < 0) {
     file_cache_size = kMaxFileCacheSize;
   }
-  file_cache_ = NewLRUCache(file_cache_size);
+  file_cache_ = NewLRUCache(file_cache_size,
+                            db_options_.blob_file_cache_num_shard_bits);
+}
+
+BlobFileSet::~BlobFileSet() {
+  delete storage_view_.load();
+  // Frees storages of dropped column families that are no longer read.
+  EpochDomain::Default()->Reclaim();
 }
 
 Status BlobFileSet::Open(
     const std::map<uint32_t, TitanCFOptions>& column_families) {
+  Status s;
+  if (!db_options_.blob_flash_cache_path.empty()) {
+    s = BlobFlashCache::Open(env_, db_options_.blob_flash_cache_path,
+                             db_options_.blob_flash_cache_size, &flash_cache_);
+    if (!s.ok()) {
+      return s;
+    }
+  }
   // Sets up initial column families.
   AddColumnFamilies(column_families);
 
-  Status s = env_->FileExists(CurrentFileName(dirname_));
+  s = env_->FileExists(CurrentFileName(dirname_));
   if (s.ok()) {
     return Recover();
   }
@@ -143,9 +180,66 @@ Status BlobFileSet::Recover() {
     env_->DeleteFile(dirname_ + "/" + f);
   }
 
+  if (db_options_.preload_blob_file_readers) {
+    PreloadBlobFileReaders();
+  }
+
   return Status::OK();
 }
 
+void BlobFileSet::PreloadBlobFileReaders() {
+  struct PreloadTask {
+    BlobFileCache* file_cache;
+    uint64_t file_number;
+    uint64_t file_size;
+  };
+  std::vector<PreloadTask> tasks;
+  for (const auto& bs : column_families_) {
+    for (const auto& f : bs.second->files_) {
+      if (f.second->is_obsolete()) continue;
+      tasks.push_back({bs.second->file_cache_.get(), f.second->file_number(),
+                       f.second->file_size()});
+    }
+  }
+  if (tasks.empty()) return;
+
+  uint64_t start_micros = env_->NowMicros();
+  std::atomic<size_t> next_task{0};
+  std::atomic<size_t> num_failed{0};
+  auto preload_func = [&]() {
+    while (true) {
+      size_t i = next_task.fetch_add(1);
+      if (i >= tasks.size()) break;
+      const auto& task = tasks[i];
+      Status s = task.file_cache->Preload(task.file_number, task.file_size);
+      if (!s.ok()) {
+        num_failed.fetch_add(1);
+        ROCKS_LOG_WARN(db_options_.info_log,
+                       "Failed to preload blob file %" PRIu64 ": %s",
+                       task.file_number, s.ToString().c_str());
+      }
+    }
+  };
+
+  size_t num_threads = static_cast<size_t>(
+      std::max(db_options_.max_file_opening_threads, 1));
+  num_threads = std::min(num_threads, tasks.size());
+  std::vector<port::Thread> threads;
+  for (size_t i = 1; i < num_threads; i++) {
+    threads.emplace_back(preload_func);
+  }
+  preload_func();
+  for (auto& t : threads) {
+    t.join();
+  }
+  ROCKS_LOG_INFO(db_options_.info_log,
+                 "Preloaded %" ROCKSDB_PRIszt " of %" ROCKSDB_PRIszt
+                 " blob file readers with %" ROCKSDB_PRIszt
+                 " threads in %" PRIu64 " us.",
+                 tasks.size() - num_failed.load(), tasks.size(), num_threads,
+                 env_->NowMicros() - start_micros);
+}
+
 Status BlobFileSet::OpenManifest(uint64_t file_number) {
   Status s;
 
@@ -232,12 +326,29 @@ Status BlobFileSet::LogAndApply(VersionEdit& edit) {
 void BlobFileSet::AddColumnFamilies(
     const std::map<uint32_t, TitanCFOptions>& column_families) {
   for (auto& cf : column_families) {
-    auto file_cache = std::make_shared<BlobFileCache>(db_options_, cf.second,
-                                                      file_cache_, stats_);
+    auto file_cache = std::make_shared<BlobFileCache>(
+        db_options_, cf.second, file_cache_, stats_, flash_cache_);
     auto blob_storage = std::make_shared<BlobStorage>(
         db_options_, cf.second, cf.first, file_cache, stats_);
     column_families_.emplace(cf.first, blob_storage);
   }
+  PublishStorageView();
+}
+
+void BlobFileSet::PublishStorageView() {
+  auto view = new StorageMap();
+  for (auto& cf : column_families_) {
+    view->emplace(cf.first, cf.second.get());
+  }
+  const StorageMap* old_view = storage_view_.exchange(view);
+  EpochDomain::Default()->Retire([old_view]() { delete old_view; });
+}
+
+void BlobFileSet::RetireBlobStorage(std::shared_ptr<BlobStorage> storage) {
+  PublishStorageView();
+  // The deleter does nothing itself, destroying it drops the last
+  // reference.
+  EpochDomain::Default()->Retire([storage]() {});
 }
 
 Status BlobFileSet::DropColumnFamilies(
@@ -275,7 +386,9 @@ Status BlobFileSet::MaybeDestroyColumnFamily(uint32_t cf_id) {
   if (it != column_families_.end()) {
     it->second->MarkDestroyed();
     if (it->second->MaybeRemove()) {
+      auto storage = it->second;
       column_families_.erase(it);
+      RetireBlobStorage(std::move(storage));
     }
     return Status::OK();
   }
@@ -325,7 +438,9 @@ void BlobFileSet::GetObsoleteFiles(std::vector<std::string>* obsolete_files,
     // Cleanup obsolete column family when all the blob files for that are
     // deleted.
     if (blob_storage->MaybeRemove()) {
+      auto storage = blob_storage;
       it = column_families_.erase(it);
+      RetireBlobStorage(std::move(storage));
       continue;
     }
     ++it;
@@ -336,5 +451,174 @@ void BlobFileSet::GetObsoleteFiles(std::vector<std::string>* obsolete_files,
   obsolete_manifests_.clear();
 }
 
+Status BlobFileSet::DumpHotBlobs() {
+  std::vector<HotBlob> blobs;
+  {
+    EpochGuard guard;
+    for (const auto& cf : *storage_view_.load(std::memory_order_acquire)) {
+      auto tracker = cf.second->file_cache_->access_tracker();
+      if (tracker != nullptr) {
+        tracker->GetRecent(cf.first, &blobs);
+      }
+    }
+  }
+  return WriteHotBlobs(env_, HotBlobsFileName(dirname_), blobs);
+}
+
+void BlobFileSet::WarmUpBlobCache(const std::atomic<bool>* cancel) {
+  std::vector<HotBlob> blobs;
+  Status s = ReadHotBlobs(env_, HotBlobsFileName(dirname_), &blobs);
+  if (!s.ok()) {
+    if (!s.IsNotFound()) {
+      ROCKS_LOG_WARN(db_options_.info_log, "Failed to read hot blobs: %s",
+                     s.ToString().c_str());
+    }
+    return;
+  }
+
+  // Keeps what fits into the blob cache of every column family, and
+  // groups it by file, the file of the hottest record first.
+  struct FileBlobs {
+    uint32_t cf_id;
+    uint64_t file_number;
+    std::vector<BlobHandle> handles;
+  };
+  std::vector<FileBlobs> files;
+  {
+    EpochGuard guard;
+    std::map<uint32_t, uint64_t> budgets;
+    std::map<std::pair<uint32_t, uint64_t>, size_t> file_index;
+    for (const auto& blob : blobs) {
+      auto budget = budgets.find(blob.cf_id);
+      if (budget == budgets.end()) {
+        BlobStorage* storage = GetBlobStorageUnlocked(blob.cf_id);
+        uint64_t capacity = 0;
+        if (storage != nullptr && storage->cf_options().blob_cache) {
+          capacity = storage->cf_options().blob_cache->GetCapacity();
+        }
+        budget = budgets.emplace(blob.cf_id, capacity).first;
+      }
+      if (blob.handle.size > budget->second) {
+        budget->second = 0;
+        continue;
+      }
+      budget->second -= blob.handle.size;
+      auto key = std::make_pair(blob.cf_id, blob.file_number);
+      auto it = file_index.find(key);
+      if (it == file_index.end()) {
+        it = file_index.emplace(key, files.size()).first;
+        files.push_back(FileBlobs{blob.cf_id, blob.file_number, {}});
+      }
+      files[it->second].handles.push_back(blob.handle);
+    }
+  }
+
+  std::unique_ptr<RateLimiter> limiter;
+  if (db_options_.blob_cache_warmup_bytes_per_sec > 0) {
+    // Only limits reads in kAllIo mode.
+    limiter.reset(NewGenericRateLimiter(
+        static_cast<int64_t>(db_options_.blob_cache_warmup_bytes_per_sec),
+        100 * 1000 /*refill_period_us*/, 10 /*fairness*/,
+        RateLimiter::Mode::kAllIo));
+  }
+  uint64_t start_micros = env_->NowMicros();
+  uint64_t num_loaded = 0;
+  uint64_t num_skipped = 0;
+  bool cancelled = false;
+  ReadOptions options;
+  for (auto& file : files) {
+    auto& handles = file.handles;
+    // Reads every file sequentially.
+    std::sort(handles.begin(), handles.end(),
+              [](const BlobHandle& a, const BlobHandle& b) {
+                return a.offset < b.offset;
+              });
+    size_t begin = 0;
+    while (begin < handles.size() && !cancelled) {
+      if (cancel->load(std::memory_order_acquire)) {
+        cancelled = true;
+        break;
+      }
+      uint64_t start = handles[begin].offset;
+      size_t end = begin + 1;
+      while (end < handles.size() &&
+             handles[end].offset + handles[end].size - start <=
+                 kWarmUpBatchSize) {
+        end++;
+      }
+      if (limiter) {
+        int64_t bytes = static_cast<int64_t>(
+            handles[end - 1].offset + handles[end - 1].size - start);
+        while (bytes > 0) {
+          int64_t request = std::min(bytes, limiter->GetSingleBurstBytes());
+          limiter->Request(request, Env::IO_LOW, nullptr /*stats*/,
+                           RateLimiter::OpType::kRead);
+          bytes -= request;
+        }
+        TEST_SYNC_POINT_CALLBACK("BlobFileSet::WarmUpBlobCache:Limited",
+                                 limiter.get());
+      }
+
+      size_t n = end - begin;
+      std::vector<BlobRecord> records(n);
+      std::vector<PinnableSlice> buffers(n);
+      std::vector<BlobGetRequest> requests(n);
+      std::vector<BlobGetRequest*> request_ptrs(n);
+      for (size_t i = 0; i < n; i++) {
+        requests[i].handle = handles[begin + i];
+        requests[i].record = &records[i];
+        requests[i].buffer = &buffers[i];
+        request_ptrs[i] = &requests[i];
+      }
+      bool file_gone = false;
+      {
+        EpochGuard guard;
+        BlobStorage* storage = GetBlobStorageUnlocked(file.cf_id);
+        file_gone = storage == nullptr ||
+                    storage->FindFileUnlocked(file.file_number) == nullptr;
+        if (!file_gone) {
+          storage->MultiGet(options, file.file_number, request_ptrs,
+                            kWarmUpReadGap);
+        }
+      }
+      if (file_gone) {
+        num_skipped += handles.size() - begin;
+        if (stats_ != nullptr) {
+          stats_->recordTick(TitanStats::BLOB_CACHE_WARMUP_SKIPPED,
+                             handles.size() - begin);
+        }
+        break;
+      }
+      uint64_t batch_loaded = 0;
+      uint64_t batch_bytes = 0;
+      for (const auto& request : requests) {
+        if (request.status.ok()) {
+          batch_loaded++;
+          batch_bytes += request.handle.size;
+        }
+      }
+      num_loaded += batch_loaded;
+      num_skipped += n - batch_loaded;
+      if (stats_ != nullptr) {
+        stats_->recordTick(TitanStats::BLOB_CACHE_WARMUP_RECORDS,
+                           batch_loaded);
+        stats_->recordTick(TitanStats::BLOB_CACHE_WARMUP_BYTES, batch_bytes);
+        stats_->recordTick(TitanStats::BLOB_CACHE_WARMUP_SKIPPED,
+                           n - batch_loaded);
+      }
+      begin = end;
+    }
+    if (cancelled) {
+      break;
+    }
+  }
+  ROCKS_LOG_INFO(db_options_.info_log,
+                 "Blob cache warm-up %s: loaded %" PRIu64
+                 " records, skipped %" PRIu64 " of %" ROCKSDB_PRIszt
+                 " in %" PRIu64 " us.",
+                 cancelled ? "cancelled" : "done", num_loaded, num_skipped,
+                 blobs.size(), env_->NowMicros() - start_micros);
+}
+
 }  // namespace titandb
 }  // namespace rocksdb
@@ -26,6 +26,8 @@ class BlobFileSet {
  public:
   explicit BlobFileSet(const TitanDBOptions& options, TitanStats* stats);
 
+  ~BlobFileSet();
+
   // Sets up the storage specified in "options.dirname".
   // If the manifest doesn't exist, it will create one.
   // If the manifest exists, it will recover from the latest one.
@@ -71,6 +73,16 @@ class BlobFileSet {
     return std::weak_ptr<BlobStorage>();
   }
 
+  // Same as GetBlobStorage, but takes no lock and touches no refcount.
+  // Returns nullptr if the column family doesn't exist. The storage stays
+  // valid until the caller leaves its EpochGuard.
+  // REQUIRE: inside an EpochGuard
+  BlobStorage* GetBlobStorageUnlocked(uint32_t cf_id) const {
+    const StorageMap* view = storage_view_.load(std::memory_order_acquire);
+    auto it = view->find(cf_id);
+    return it != view->end() ? it->second : nullptr;
+  }
+
   // REQUIRES: mutex is held
   void GetObsoleteFiles(std::vector<std::string>* obsolete_files,
                         SequenceNumber oldest_sequence);
@@ -93,21 +105,49 @@ class BlobFileSet {
     }
   }
 
+  // Writes the handles of the records recently read into the blob caches
+  // to a file, see TitanDBOptions::blob_cache_dump_period_sec.
+  Status DumpHotBlobs();
+
+  // Loads the records of the last DumpHotBlobs into the blob caches, most
+  // recent first and as much as the caches hold. Returns early once
+  // "cancel" is set.
+  void WarmUpBlobCache(const std::atomic<bool>* cancel);
+
  private:
   friend class BlobFileSizeCollectorTest;
+  friend class TitanDBTest;
   friend class VersionTest;
 
   Status Recover();
 
   Status OpenManifest(uint64_t number);
 
+  // Opens the readers of all live blob files in parallel, see
+  // TitanDBOptions::preload_blob_file_readers. Failures are only logged,
+  // the files are opened again on their first read.
+  void PreloadBlobFileReaders();
+
   Status WriteSnapshot(log::Writer* log);
 
+  using StorageMap = std::unordered_map<uint32_t, BlobStorage*>;
+
+  // Publishes the current column families to lock-free readers.
+  // REQUIRES: mutex is held
+  void PublishStorageView();
+
+  // Called after a storage is erased from column_families_. Keeps it alive
+  // until no lock-free reader can see it.
+  // REQUIRES: mutex is held
+  void RetireBlobStorage(std::shared_ptr<BlobStorage> storage);
+
   std::string dirname_;
   Env* env_;
   EnvOptions env_options_;
   TitanDBOptions db_options_;
   std::shared_ptr<Cache> file_cache_;
+  // Null if blob_flash_cache_path is empty.
+  std::shared_ptr<BlobFlashCache> flash_cache_;
 
   TitanStats* stats_;
 
@@ -122,6 +162,8 @@ class BlobFileSet {
   std::unordered_set<uint32_t> obsolete_columns_;
 
   std::unordered_map<uint32_t, std::shared_ptr<BlobStorage>> column_families_;
+  // Immutable copy of column_families_ read by GetBlobStorageUnlocked.
+  std::atomic<const StorageMap*> storage_view_;
   std::unique_ptr<log::Writer> manifest_;
   std::atomic<uint64_t> next_file_number_{1};
 };
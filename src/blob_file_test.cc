@@ -1,4 +1,5 @@
 #include "file/filename.h"
+#include "test_util/sync_point.h"
 #include "test_util/testharness.h"
 
 #include "blob_file_builder.h"
@@ -29,15 +30,12 @@ class BlobFileTest : public testing::Test {
 
   std::string GenValue(uint64_t i) { return std::string(1024, i); }
 
-  void TestBlobFilePrefetcher(TitanOptions options) {
-    options.dirname = dirname_;
+  // Writes n records of GenKey(i) and GenValue(i) to the blob file.
+  void BuildBlobFile(const TitanOptions& options, int n,
+                     std::vector<BlobHandle>* handles, uint64_t* file_size) {
     TitanDBOptions db_options(options);
     TitanCFOptions cf_options(options);
-    BlobFileCache cache(db_options, cf_options, {NewLRUCache(128)}, nullptr);
-
-    const int n = 100;
-    std::vector<BlobHandle> handles(n);
-
+    handles->resize(n);
     std::unique_ptr<WritableFileWriter> file;
     {
       std::unique_ptr<WritableFile> f;
@@ -45,23 +43,30 @@ class BlobFileTest : public testing::Test {
       file.reset(
           new WritableFileWriter(std::move(f), file_name_, env_options_));
     }
-    std::unique_ptr<BlobFileBuilder> builder(
-        new BlobFileBuilder(db_options, cf_options, file.get()));
-
+    BlobFileBuilder builder(db_options, cf_options, file.get());
     for (int i = 0; i < n; i++) {
       auto key = GenKey(i);
       auto value = GenValue(i);
       BlobRecord record;
       record.key = key;
       record.value = value;
-      builder->Add(record, &handles[i]);
-      ASSERT_OK(builder->status());
+      builder.Add(record, &(*handles)[i]);
+      ASSERT_OK(builder.status());
     }
-    ASSERT_OK(builder->Finish());
-    ASSERT_OK(builder->status());
+    ASSERT_OK(builder.Finish());
+    ASSERT_OK(env_->GetFileSize(file_name_, file_size));
+  }
 
+  void TestBlobFilePrefetcher(TitanOptions options) {
+    options.dirname = dirname_;
+    TitanDBOptions db_options(options);
+    TitanCFOptions cf_options(options);
+    BlobFileCache cache(db_options, cf_options, {NewLRUCache(128)}, nullptr);
+
+    const int n = 100;
+    std::vector<BlobHandle> handles;
     uint64_t file_size = 0;
-    ASSERT_OK(env_->GetFileSize(file_name_, &file_size));
+    ASSERT_NO_FATAL_FAILURE(BuildBlobFile(options, n, &handles, &file_size));
 
     ReadOptions ro;
     std::unique_ptr<BlobFilePrefetcher> prefetcher;
@@ -88,6 +93,34 @@ class BlobFileTest : public testing::Test {
       ASSERT_OK(prefetcher->Get(ro, handles[i], &record, &buffer));
       ASSERT_EQ(record, expect);
     }
+
+    // Reading backward reads ahead the regions before, growing them.
+    std::vector<uint64_t> prefetched;
+    SyncPoint::GetInstance()->SetCallBack(
+        "BlobFileReader::Prefetch", [&](void* arg) {
+          prefetched.push_back(*reinterpret_cast<uint64_t*>(arg));
+        });
+    SyncPoint::GetInstance()->EnableProcessing();
+    ASSERT_OK(cache.NewPrefetcher(file_number_, file_size, &prefetcher));
+    for (int i = n - 1; i >= 0; i--) {
+      BlobRecord expect;
+      std::string key = GenKey(i);
+      std::string value = GenValue(i);
+      expect.key = key;
+      expect.value = value;
+      BlobRecord record;
+      PinnableSlice buffer;
+      ASSERT_OK(prefetcher->Get(ro, handles[i], &record, &buffer));
+      ASSERT_EQ(record, expect);
+    }
+    SyncPoint::GetInstance()->DisableProcessing();
+    SyncPoint::GetInstance()->ClearAllCallBacks();
+    ASSERT_GT(prefetched.size(), 1U);
+    ASSERT_LT(prefetched.size(), static_cast<size_t>(n / 2));
+    for (size_t i = 1; i < prefetched.size(); i++) {
+      ASSERT_LT(prefetched[i], prefetched[i - 1]);
+    }
+    ASSERT_LE(prefetched.back(), handles[0].offset);
   }
 
   void TestBlobFileReader(TitanOptions options) {
@@ -97,32 +130,9 @@ class BlobFileTest : public testing::Test {
     BlobFileCache cache(db_options, cf_options, {NewLRUCache(128)}, nullptr);
 
     const int n = 100;
-    std::vector<BlobHandle> handles(n);
-
-    std::unique_ptr<WritableFileWriter> file;
-    {
-      std::unique_ptr<WritableFile> f;
-      ASSERT_OK(env_->NewWritableFile(file_name_, &f, env_options_));
-      file.reset(
-          new WritableFileWriter(std::move(f), file_name_, env_options_));
-    }
-    std::unique_ptr<BlobFileBuilder> builder(
-        new BlobFileBuilder(db_options, cf_options, file.get()));
-
-    for (int i = 0; i < n; i++) {
-      auto key = GenKey(i);
-      auto value = GenValue(i);
-      BlobRecord record;
-      record.key = key;
-      record.value = value;
-      builder->Add(record, &handles[i]);
-      ASSERT_OK(builder->status());
-    }
-    ASSERT_OK(builder->Finish());
-    ASSERT_OK(builder->status());
-
+    std::vector<BlobHandle> handles;
     uint64_t file_size = 0;
-    ASSERT_OK(env_->GetFileSize(file_name_, &file_size));
+    ASSERT_NO_FATAL_FAILURE(BuildBlobFile(options, n, &handles, &file_size));
 
     ReadOptions ro;
     std::unique_ptr<RandomAccessFileReader> random_access_file_reader;
@@ -156,6 +166,96 @@ class BlobFileTest : public testing::Test {
     }
   }
 
+  void TestBlobFileMultiGet(TitanOptions options, uint64_t max_gap) {
+    options.dirname = dirname_;
+    TitanDBOptions db_options(options);
+    TitanCFOptions cf_options(options);
+    BlobFileCache cache(db_options, cf_options, {NewLRUCache(128)}, nullptr);
+
+    const int n = 100;
+    std::vector<BlobHandle> handles;
+    uint64_t file_size = 0;
+    ASSERT_NO_FATAL_FAILURE(BuildBlobFile(options, n, &handles, &file_size));
+
+    // Unordered, with neighbours, gaps and a duplicate.
+    std::vector<int> targets = {42, 7, 8, 9, 60, 11, 99, 0, 8};
+    std::vector<BlobRecord> records(targets.size());
+    std::unique_ptr<PinnableSlice[]> buffers(
+        new PinnableSlice[targets.size()]);
+    std::vector<BlobGetRequest> requests(targets.size());
+    std::vector<BlobGetRequest*> batch;
+    for (size_t i = 0; i < targets.size(); i++) {
+      requests[i].handle = handles[targets[i]];
+      requests[i].record = &records[i];
+      requests[i].buffer = &buffers[i];
+      batch.push_back(&requests[i]);
+    }
+    ReadOptions ro;
+    cache.MultiGet(ro, file_number_, file_size, batch, max_gap);
+    for (size_t i = 0; i < targets.size(); i++) {
+      auto key = GenKey(targets[i]);
+      auto value = GenValue(targets[i]);
+      BlobRecord expect;
+      expect.key = key;
+      expect.value = value;
+      ASSERT_OK(requests[i].status);
+      ASSERT_EQ(records[i], expect);
+    }
+    // Records sharing a read stay valid as their neighbours are released.
+    for (size_t i = 0; i < targets.size(); i += 2) {
+      buffers[i].Reset();
+    }
+    for (size_t i = 1; i < targets.size(); i += 2) {
+      ASSERT_EQ(GenValue(targets[i]), records[i].value.ToString());
+    }
+  }
+
+  void TestBlobFileReadOptions(TitanOptions options) {
+    options.dirname = dirname_;
+    options.blob_cache = NewLRUCache(1 << 20);
+    TitanDBOptions db_options(options);
+    TitanCFOptions cf_options(options);
+    BlobFileCache cache(db_options, cf_options, {NewLRUCache(128)}, nullptr);
+
+    const int n = 10;
+    std::vector<BlobHandle> handles;
+    uint64_t file_size = 0;
+    ASSERT_NO_FATAL_FAILURE(BuildBlobFile(options, n, &handles, &file_size));
+
+    ReadOptions cache_only;
+    cache_only.read_tier = kBlockCacheTier;
+    ReadOptions no_fill;
+    no_fill.fill_cache = false;
+    BlobRecord record;
+    PinnableSlice buffer;
+    // The file itself isn't open yet.
+    ASSERT_TRUE(cache.Get(cache_only, file_number_, file_size, handles[0],
+                          &record, &buffer)
+                    .IsIncomplete());
+    for (int i = 0; i < n; i++) {
+      BlobRecord expect;
+      auto key = GenKey(i);
+      auto value = GenValue(i);
+      expect.key = key;
+      expect.value = value;
+      buffer.Reset();
+      ASSERT_OK(cache.Get(no_fill, file_number_, file_size, handles[i],
+                          &record, &buffer));
+      ASSERT_EQ(record, expect);
+      buffer.Reset();
+      ASSERT_TRUE(cache.Get(cache_only, file_number_, file_size, handles[i],
+                            &record, &buffer)
+                      .IsIncomplete());
+      buffer.Reset();
+      ASSERT_OK(cache.Get(ReadOptions(), file_number_, file_size, handles[i],
+                          &record, &buffer));
+      buffer.Reset();
+      ASSERT_OK(cache.Get(cache_only, file_number_, file_size, handles[i],
+                          &record, &buffer));
+      ASSERT_EQ(record, expect);
+    }
+  }
+
   Env* env_{Env::Default()};
   EnvOptions env_options_;
   std::string dirname_;
@@ -170,6 +270,26 @@ TEST_F(BlobFileTest, BlobFileReader) {
   TestBlobFileReader(options);
 }
 
+TEST_F(BlobFileTest, BlobFileMultiGet) {
+  TitanOptions options;
+  TestBlobFileMultiGet(options, 0);
+  TestBlobFileMultiGet(options, 64 << 10);
+  options.blob_cache = NewLRUCache(1 << 20);
+  TestBlobFileMultiGet(options, 4 << 10);
+  options.blob_file_compression = kLZ4Compression;
+  TestBlobFileMultiGet(options, 64 << 10);
+  // Served by io_uring when built with liburing, by pread otherwise.
+  options.blob_cache = nullptr;
+  options.blob_io_uring_queue_depth = 4;
+  TestBlobFileMultiGet(options, 0);
+  TestBlobFileMultiGet(options, 4 << 10);
+}
+
+TEST_F(BlobFileTest, BlobFileReadOptions) {
+  TitanOptions options;
+  TestBlobFileReadOptions(options);
+}
+
 TEST_F(BlobFileTest, BlobFilePrefetcher) {
   TitanOptions options;
   TestBlobFilePrefetcher(options);
@@ -179,6 +299,309 @@ TEST_F(BlobFileTest, BlobFilePrefetcher) {
   TestBlobFilePrefetcher(options);
 }
 
+TEST_F(BlobFileTest, BlobFileMmapReads) {
+  for (bool use_cache : {false, true}) {
+    TitanOptions options;
+    options.dirname = dirname_;
+    if (use_cache) {
+      options.blob_cache = NewLRUCache(1 << 20);
+    }
+    TitanDBOptions db_options(options);
+    TitanCFOptions cf_options(options);
+    BlobFileCache cache(db_options, cf_options, {NewLRUCache(128)}, nullptr);
+    cache.SetMmapReads(file_number_);
+
+    const int n = 100;
+    std::vector<BlobHandle> handles;
+    uint64_t file_size = 0;
+    ASSERT_NO_FATAL_FAILURE(BuildBlobFile(options, n, &handles, &file_size));
+
+    ReadOptions ro;
+    std::unique_ptr<RandomAccessFileReader> random_access_file_reader;
+    ASSERT_OK(NewBlobFileReader(file_number_, 0, db_options, env_options_, env_,
+                                &random_access_file_reader));
+    std::unique_ptr<BlobFileReader> reader;
+    ASSERT_OK(BlobFileReader::Open(
+        cf_options, std::move(random_access_file_reader), file_size, &reader,
+        nullptr, 0 /*io_queue_depth*/, true /*verify_footer*/,
+        true /*mmap_reads*/));
+    ASSERT_TRUE(reader->mmapped());
+    std::unique_ptr<BlobFilePrefetcher> prefetcher;
+    ASSERT_OK(cache.NewPrefetcher(file_number_, file_size, &prefetcher));
+    for (int i = 0; i < n; i++) {
+      BlobRecord expect;
+      auto key = GenKey(i);
+      auto value = GenValue(i);
+      expect.key = key;
+      expect.value = value;
+      BlobRecord record;
+      PinnableSlice buffer;
+      ASSERT_OK(reader->Get(ro, handles[i], &record, &buffer));
+      ASSERT_EQ(record, expect);
+      buffer.Reset();
+      ASSERT_OK(prefetcher->Get(ro, handles[i], &record, &buffer));
+      ASSERT_EQ(record, expect);
+      buffer.Reset();
+      PinnableSlice partial;
+      ASSERT_OK(cache.GetPartial(ro, file_number_, file_size, handles[i],
+                                 value.size(), false /*only_value*/, 10, 20,
+                                 &partial));
+      ASSERT_EQ(partial, Slice(value.data() + 10, 20));
+    }
+    prefetcher.reset();
+
+    // Records read through the cache keep the mapping alive after the
+    // file is evicted.
+    BlobRecord record;
+    PinnableSlice buffer;
+    ASSERT_OK(
+        cache.Get(ro, file_number_, file_size, handles[0], &record, &buffer));
+    cache.Evict(file_number_);
+    BlobRecord expect;
+    auto key = GenKey(0);
+    auto value = GenValue(0);
+    expect.key = key;
+    expect.value = value;
+    ASSERT_EQ(record, expect);
+  }
+}
+
+TEST_F(BlobFileTest, BlobFileDirectReads) {
+  TitanOptions options;
+  options.dirname = dirname_;
+  options.use_direct_blob_reads = true;
+  {
+    // Skips file systems without direct I/O, e.g. tmpfs.
+    std::unique_ptr<WritableFile> f;
+    ASSERT_OK(env_->NewWritableFile(file_name_, &f, env_options_));
+    ASSERT_OK(f->Close());
+    EnvOptions direct_options;
+    direct_options.use_direct_reads = true;
+    std::unique_ptr<RandomAccessFile> r;
+    if (!env_->NewRandomAccessFile(file_name_, &r, direct_options).ok()) {
+      return;
+    }
+  }
+  TestBlobFileReader(options);
+  TestBlobFileMultiGet(options, 4 << 10);
+  options.blob_file_compression = kLZ4Compression;
+  TestBlobFileReader(options);
+}
+
+TEST_F(BlobFileTest, BlobCacheAdmission) {
+  for (auto admission :
+       {TitanBlobCacheAdmission::kAll, TitanBlobCacheAdmission::kTinyLFU}) {
+    TitanOptions options;
+    options.dirname = dirname_;
+    // Room for about 15 records, in a plain LRU.
+    options.blob_cache =
+        NewLRUCache(16 << 10, 0 /*num_shard_bits*/,
+                    false /*strict_capacity_limit*/, 0 /*high_pri_ratio*/);
+    options.blob_cache_admission = admission;
+    TitanDBOptions db_options(options);
+    TitanCFOptions cf_options(options);
+    BlobFileCache cache(db_options, cf_options, {NewLRUCache(128)}, nullptr);
+
+    const int n = 100;
+    std::vector<BlobHandle> handles;
+    uint64_t file_size = 0;
+    ASSERT_NO_FATAL_FAILURE(BuildBlobFile(options, n, &handles, &file_size));
+
+    ReadOptions ro;
+    ReadOptions cache_only;
+    cache_only.read_tier = kBlockCacheTier;
+    auto cached = [&](int i) {
+      BlobRecord record;
+      PinnableSlice buffer;
+      return cache
+          .Get(cache_only, file_number_, file_size, handles[i], &record,
+               &buffer)
+          .ok();
+    };
+    // A hot set read repeatedly, then a scan reading everything once.
+    const int hot = 4;
+    for (int round = 0; round < 3; round++) {
+      for (int i = 0; i < hot; i++) {
+        BlobRecord record;
+        PinnableSlice buffer;
+        ASSERT_OK(cache.Get(ro, file_number_, file_size, handles[i], &record,
+                            &buffer));
+      }
+    }
+    for (int i = hot; i < n; i++) {
+      BlobRecord record;
+      PinnableSlice buffer;
+      ASSERT_OK(
+          cache.Get(ro, file_number_, file_size, handles[i], &record, &buffer));
+    }
+    if (admission == TitanBlobCacheAdmission::kAll) {
+      // The scan flushed the hot set out of the cache.
+      for (int i = 0; i < hot; i++) {
+        ASSERT_FALSE(cached(i));
+      }
+      ASSERT_TRUE(cached(n - 1));
+    } else {
+      // Once the cache is full, records read once are not admitted.
+      for (int i = 0; i < hot; i++) {
+        ASSERT_TRUE(cached(i));
+      }
+      ASSERT_FALSE(cached(n - 1));
+    }
+  }
+}
+
+TEST_F(BlobFileTest, BlobCompressedCache) {
+  for (bool compressed_cache : {false, true}) {
+    TitanOptions options;
+    options.dirname = dirname_;
+    // Room for a few records only.
+    options.blob_cache = NewLRUCache(4 << 10, 0 /*num_shard_bits*/);
+    if (compressed_cache) {
+      options.blob_compressed_cache = NewLRUCache(1 << 20);
+    }
+    TitanDBOptions db_options(options);
+    TitanCFOptions cf_options(options);
+    BlobFileCache cache(db_options, cf_options, {NewLRUCache(128)}, nullptr);
+
+    const int n = 100;
+    std::vector<BlobHandle> handles;
+    uint64_t file_size = 0;
+    ASSERT_NO_FATAL_FAILURE(BuildBlobFile(options, n, &handles, &file_size));
+
+    ReadOptions ro;
+    for (int i = 0; i < n; i++) {
+      BlobRecord record;
+      PinnableSlice buffer;
+      ASSERT_OK(
+          cache.Get(ro, file_number_, file_size, handles[i], &record, &buffer));
+    }
+    // Records evicted from the blob cache are still served without I/O
+    // from the compressed one.
+    ReadOptions cache_only;
+    cache_only.read_tier = kBlockCacheTier;
+    for (int i = 0; i < n; i++) {
+      BlobRecord record;
+      PinnableSlice buffer;
+      Status s = cache.Get(cache_only, file_number_, file_size, handles[i],
+                           &record, &buffer);
+      if (!compressed_cache) {
+        ASSERT_TRUE(i >= n - 3 || s.IsIncomplete());
+        continue;
+      }
+      ASSERT_OK(s);
+      BlobRecord expect;
+      auto key = GenKey(i);
+      auto value = GenValue(i);
+      expect.key = key;
+      expect.value = value;
+      ASSERT_EQ(record, expect);
+    }
+  }
+}
+
+TEST_F(BlobFileTest, BlobFlashCache) {
+  TitanOptions options;
+  options.dirname = dirname_;
+  TitanDBOptions db_options(options);
+  TitanCFOptions cf_options(options);
+  std::string flash_path = dirname_ + "/flash_cache";
+
+  const int n = 10;
+  std::vector<BlobHandle> handles;
+  uint64_t file_size = 0;
+  ASSERT_NO_FATAL_FAILURE(BuildBlobFile(options, n, &handles, &file_size));
+  {
+    // Skips file systems without unique file ids, which the flash cache
+    // keys records by.
+    std::unique_ptr<RandomAccessFile> f;
+    ASSERT_OK(env_->NewRandomAccessFile(file_name_, &f, env_options_));
+    char id[kMaxVarint64Length * 3 + 1];
+    if (f->GetUniqueId(id, sizeof(id)) == 0) {
+      return;
+    }
+  }
+
+  ReadOptions ro;
+  {
+    std::shared_ptr<BlobFlashCache> flash_cache;
+    ASSERT_OK(BlobFlashCache::Open(env_, flash_path, 1 << 20, &flash_cache));
+    BlobFileCache cache(db_options, cf_options, {NewLRUCache(128)}, nullptr,
+                        flash_cache);
+    // Only records read again are written to the flash cache.
+    for (int round = 0; round < 2; round++) {
+      for (int i = 0; i < n; i += round + 1) {
+        BlobRecord record;
+        PinnableSlice buffer;
+        ASSERT_OK(cache.Get(ro, file_number_, file_size, handles[i], &record,
+                            &buffer));
+      }
+    }
+  }
+  // Wipes the records but keeps the file, so that only the flash cache
+  // can serve them.
+  {
+    std::unique_ptr<RandomRWFile> f;
+    ASSERT_OK(env_->NewRandomRWFile(file_name_, &f, env_options_));
+    uint64_t records_end = handles[n - 1].offset + handles[n - 1].size;
+    std::string zeros(records_end - BlobFileHeader::kEncodedLength, 0);
+    ASSERT_OK(f->Write(BlobFileHeader::kEncodedLength, zeros));
+    ASSERT_OK(f->Close());
+  }
+  // The flash cache is recovered from its file.
+  std::shared_ptr<BlobFlashCache> flash_cache;
+  ASSERT_OK(BlobFlashCache::Open(env_, flash_path, 1 << 20, &flash_cache));
+  BlobFileCache cache(db_options, cf_options, {NewLRUCache(128)}, nullptr,
+                      flash_cache);
+  for (int i = 0; i < n; i++) {
+    BlobRecord record;
+    PinnableSlice buffer;
+    Status s =
+        cache.Get(ro, file_number_, file_size, handles[i], &record, &buffer);
+    if (i % 2 != 0) {
+      ASSERT_FALSE(s.ok() && record.value == GenValue(i));
+      continue;
+    }
+    ASSERT_OK(s);
+    BlobRecord expect;
+    auto key = GenKey(i);
+    auto value = GenValue(i);
+    expect.key = key;
+    expect.value = value;
+    ASSERT_EQ(record, expect);
+  }
+  env_->DeleteFile(flash_path);
+}
+
+
+TEST_F(BlobFileTest, BlobFlashCacheLayoutChange) {
+  std::string flash_path = dirname_ + "/flash_cache";
+  std::string value = GenValue(0);
+  {
+    std::shared_ptr<BlobFlashCache> flash_cache;
+    ASSERT_OK(BlobFlashCache::Open(env_, flash_path, 24 << 20, &flash_cache));
+    // Only records inserted again are written.
+    flash_cache->Insert("key", value);
+    flash_cache->Insert("key", value);
+  }
+  {
+    // The queued write is done once the cache is closed.
+    std::shared_ptr<BlobFlashCache> flash_cache;
+    ASSERT_OK(BlobFlashCache::Open(env_, flash_path, 24 << 20, &flash_cache));
+    OwnedSlice found;
+    ASSERT_TRUE(flash_cache->Lookup("key", &found));
+    ASSERT_EQ(value, found.ToString());
+  }
+  // Opened with fewer segments of the same size, which line up with the
+  // old ones, the records written before are dropped, and stay so.
+  for (int i = 0; i < 2; i++) {
+    std::shared_ptr<BlobFlashCache> flash_cache;
+    ASSERT_OK(BlobFlashCache::Open(env_, flash_path, 20 << 20, &flash_cache));
+    OwnedSlice found;
+    ASSERT_FALSE(flash_cache->Lookup("key", &found));
+  }
+  env_->DeleteFile(flash_path);
+}
+
 }  // namespace titandb
 }  // namespace rocksdb
 
@@ -0,0 +1,342 @@
+#include "blob_flash_cache.h"
+
+#include <algorithm>
+
+#include "util/coding.h"
+#include "util/crc32c.h"
+
+namespace rocksdb {
+namespace titandb {
+
+namespace {
+
+// File header: magic, segment size, number of segments.
+const uint32_t kFileMagic = 0x54464331;
+const uint64_t kFileHeaderSize = 4096;
+const size_t kEncodedFileHeaderSize = 16;
+
+// Segment header: magic, sequence number.
+const uint32_t kSegmentMagic = 0x54465331;
+const uint64_t kSegmentHeaderSize = 12;
+
+// Record header: checksum, key size, value size. The checksum covers the
+// sizes, the key and the value.
+const uint64_t kRecordHeaderSize = 12;
+
+const uint64_t kMaxSegmentSize = 4 << 20;
+const uint64_t kMinSegments = 4;
+const uint64_t kSegmentAlignment = 4096;
+const size_t kAssumedValueSize = 4096;
+
+uint32_t RecordChecksum(const char* sizes, const Slice& key,
+                        const Slice& value) {
+  uint32_t crc = crc32c::Value(sizes, 8);
+  crc = crc32c::Extend(crc, key.data(), key.size());
+  return crc32c::Extend(crc, value.data(), value.size());
+}
+
+}  // namespace
+
+Status BlobFlashCache::Open(Env* env, const std::string& path,
+                            uint64_t capacity,
+                            std::shared_ptr<BlobFlashCache>* result) {
+  uint64_t segment_size = 0;
+  if (capacity > kFileHeaderSize) {
+    segment_size = std::min(kMaxSegmentSize,
+                            (capacity - kFileHeaderSize) / kMinSegments);
+    segment_size = segment_size / kSegmentAlignment * kSegmentAlignment;
+  }
+  if (segment_size == 0) {
+    return Status::InvalidArgument("blob flash cache is too small");
+  }
+  uint64_t num_segments = (capacity - kFileHeaderSize) / segment_size;
+
+  std::unique_ptr<RandomRWFile> file;
+  Status s = env->NewRandomRWFile(path, &file, EnvOptions());
+  if (!s.ok()) {
+    return s;
+  }
+  uint64_t file_size = 0;
+  s = env->GetFileSize(path, &file_size);
+  if (!s.ok()) {
+    return s;
+  }
+  std::shared_ptr<BlobFlashCache> cache(new BlobFlashCache(
+      std::move(file), segment_size, static_cast<uint32_t>(num_segments)));
+  s = cache->Recover(file_size);
+  if (!s.ok()) {
+    return s;
+  }
+  cache->writer_ = port::Thread(&BlobFlashCache::BackgroundWrite, cache.get());
+  *result = std::move(cache);
+  return s;
+}
+
+BlobFlashCache::BlobFlashCache(std::unique_ptr<RandomRWFile> file,
+                               uint64_t segment_size, uint32_t num_segments)
+    : file_(std::move(file)),
+      segment_size_(segment_size),
+      num_segments_(num_segments),
+      sketch_(segment_size * num_segments / kAssumedValueSize),
+      segment_keys_(num_segments),
+      segment_seqs_(num_segments, 0),
+      // The first record starts the first segment.
+      segment_(num_segments - 1),
+      write_offset_(segment_size),
+      pending_cv_(&mutex_) {}
+
+BlobFlashCache::~BlobFlashCache() {
+  {
+    MutexLock l(&mutex_);
+    closing_ = true;
+    pending_cv_.SignalAll();
+  }
+  if (writer_.joinable()) {
+    writer_.join();
+  }
+}
+
+uint64_t BlobFlashCache::SegmentOffset(uint32_t segment) const {
+  return kFileHeaderSize + segment * segment_size_;
+}
+
+Status BlobFlashCache::Recover(uint64_t file_size) {
+  char header[kEncodedFileHeaderSize];
+  Slice result;
+  Status s;
+  if (file_size >= kFileHeaderSize) {
+    s = file_->Read(0, sizeof(header), &result, header);
+    if (!s.ok()) {
+      return s;
+    }
+  }
+  if (result.size() == sizeof(header) &&
+      DecodeFixed32(result.data()) == kFileMagic &&
+      DecodeFixed64(result.data() + 4) == segment_size_ &&
+      DecodeFixed32(result.data() + 12) == num_segments_) {
+    for (uint32_t segment = 0; segment < num_segments_; segment++) {
+      s = RecoverSegment(segment);
+      if (!s.ok()) {
+        return s;
+      }
+    }
+    // Carries on after the segment filled last.
+    auto last = std::max_element(segment_seqs_.begin(), segment_seqs_.end());
+    if (*last > 0) {
+      segment_ = static_cast<uint32_t>(last - segment_seqs_.begin());
+      seq_ = *last;
+    }
+    return s;
+  }
+
+  // The file is new or was laid out for another capacity. Its segments
+  // may still line up with this layout, so their headers are wiped before
+  // the new file header goes in, lest records of the old layout be
+  // recovered on the next open.
+  const std::string wiped(kSegmentHeaderSize, 0);
+  for (uint32_t segment = 0; segment < num_segments_; segment++) {
+    if (SegmentOffset(segment) >= file_size) {
+      break;
+    }
+    s = file_->Write(SegmentOffset(segment), wiped);
+    if (!s.ok()) {
+      return s;
+    }
+  }
+  std::string encoded;
+  PutFixed32(&encoded, kFileMagic);
+  PutFixed64(&encoded, segment_size_);
+  PutFixed32(&encoded, num_segments_);
+  s = file_->Write(0, encoded);
+  if (s.ok()) {
+    s = file_->Sync();
+  }
+  return s;
+}
+
+Status BlobFlashCache::RecoverSegment(uint32_t segment) {
+  char header[kSegmentHeaderSize];
+  Slice result;
+  Status s = file_->Read(SegmentOffset(segment), sizeof(header), &result,
+                         header);
+  if (!s.ok() || result.size() != sizeof(header) ||
+      DecodeFixed32(result.data()) != kSegmentMagic) {
+    // Never written.
+    return s;
+  }
+  segment_seqs_[segment] = DecodeFixed64(result.data() + 4);
+  uint64_t offset = kSegmentHeaderSize;
+  std::string key;
+  while (offset + kRecordHeaderSize <= segment_size_) {
+    char record_header[kRecordHeaderSize];
+    s = file_->Read(SegmentOffset(segment) + offset, sizeof(record_header),
+                    &result, record_header);
+    if (!s.ok() || result.size() != sizeof(record_header)) {
+      break;
+    }
+    uint32_t key_size = DecodeFixed32(result.data() + 4);
+    uint32_t value_size = DecodeFixed32(result.data() + 8);
+    uint64_t size = kRecordHeaderSize + key_size + value_size;
+    if (key_size == 0 || offset + size > segment_size_) {
+      // The end of the records of this segment. Anything read past it is
+      // caught by the checksum when looked up.
+      break;
+    }
+    key.resize(key_size);
+    s = file_->Read(SegmentOffset(segment) + offset + kRecordHeaderSize,
+                    key_size, &result, &key[0]);
+    if (!s.ok() || result.size() != key_size) {
+      break;
+    }
+    std::string found = result.ToString();
+    index_[found] = Location{segment, offset, static_cast<size_t>(size)};
+    segment_keys_[segment].push_back(std::move(found));
+    offset += size;
+  }
+  // A broken segment only loses its remaining records.
+  return Status::OK();
+}
+
+void BlobFlashCache::StartSegment(uint32_t segment, std::string* header) {
+  mutex_.AssertHeld();
+  for (auto& key : segment_keys_[segment]) {
+    auto it = index_.find(key);
+    if (it != index_.end() && it->second.segment == segment) {
+      index_.erase(it);
+    }
+  }
+  segment_keys_[segment].clear();
+  seq_++;
+  segment_seqs_[segment] = seq_;
+  segment_ = segment;
+  write_offset_ = kSegmentHeaderSize;
+  PutFixed32(header, kSegmentMagic);
+  PutFixed64(header, seq_);
+}
+
+bool BlobFlashCache::Lookup(const Slice& key, OwnedSlice* value) {
+  Location location;
+  std::string key_str = key.ToString();
+  {
+    MutexLock l(&mutex_);
+    auto it = index_.find(key_str);
+    if (it == index_.end()) {
+      return false;
+    }
+    location = it->second;
+  }
+  CacheAllocationPtr buffer(new char[location.size]);
+  Slice record;
+  Status s = file_->Read(SegmentOffset(location.segment) + location.offset,
+                         location.size, &record, buffer.get());
+  bool valid = s.ok() && record.size() == location.size;
+  uint32_t key_size = 0;
+  uint32_t value_size = 0;
+  if (valid) {
+    key_size = DecodeFixed32(record.data() + 4);
+    value_size = DecodeFixed32(record.data() + 8);
+    valid = kRecordHeaderSize + key_size + value_size == location.size &&
+            Slice(record.data() + kRecordHeaderSize, key_size) == key &&
+            RecordChecksum(record.data() + 4, key,
+                           Slice(record.data() + kRecordHeaderSize + key_size,
+                                 value_size)) == DecodeFixed32(record.data());
+  }
+  if (!valid) {
+    // Overwritten since it was indexed, or never fully written.
+    MutexLock l(&mutex_);
+    auto it = index_.find(key_str);
+    if (it != index_.end() && it->second.segment == location.segment &&
+        it->second.offset == location.offset) {
+      index_.erase(it);
+    }
+    return false;
+  }
+  Slice data(record.data() + kRecordHeaderSize + key_size, value_size);
+  value->reset(std::move(buffer), data);
+  return true;
+}
+
+void BlobFlashCache::Insert(const Slice& key, const Slice& value) {
+  sketch_.RecordAccess(key);
+  if (sketch_.Estimate(key) < 2) {
+    return;
+  }
+  uint64_t size = kRecordHeaderSize + key.size() + value.size();
+  if (key.empty() || size > segment_size_ - kSegmentHeaderSize) {
+    return;
+  }
+  std::string key_str = key.ToString();
+  MutexLock l(&mutex_);
+  if (closing_ || index_.count(key_str) > 0 ||
+      pending_bytes_ + size > segment_size_) {
+    return;
+  }
+  pending_.push_back(PendingRecord{std::move(key_str), value.ToString()});
+  pending_bytes_ += size;
+  pending_cv_.Signal();
+}
+
+void BlobFlashCache::BackgroundWrite() {
+  MutexLock l(&mutex_);
+  while (true) {
+    while (pending_.empty() && !closing_) {
+      pending_cv_.Wait();
+    }
+    if (pending_.empty()) {
+      return;
+    }
+    PendingRecord record = std::move(pending_.front());
+    pending_.pop_front();
+    WriteRecord(record);
+    pending_bytes_ -=
+        kRecordHeaderSize + record.key.size() + record.value.size();
+  }
+}
+
+void BlobFlashCache::WriteRecord(const PendingRecord& pending) {
+  mutex_.AssertHeld();
+  const std::string& key = pending.key;
+  const std::string& value = pending.value;
+  if (index_.count(key) > 0) {
+    // Queued more than once.
+    return;
+  }
+  uint64_t size = kRecordHeaderSize + key.size() + value.size();
+  if (write_offset_ + size > segment_size_) {
+    uint32_t segment = (segment_ + 1) % num_segments_;
+    std::string header;
+    StartSegment(segment, &header);
+    mutex_.Unlock();
+    Status s = file_->Write(SegmentOffset(segment), header);
+    mutex_.Lock();
+    if (!s.ok()) {
+      // Moves on to the next segment with the next record.
+      write_offset_ = segment_size_;
+      return;
+    }
+  }
+  // The segment can't be reused before the write is done, as only this
+  // thread starts segments.
+  uint32_t segment = segment_;
+  uint64_t offset = write_offset_;
+  write_offset_ += size;
+
+  std::string record;
+  record.reserve(size);
+  PutFixed32(&record, 0);
+  PutFixed32(&record, static_cast<uint32_t>(key.size()));
+  PutFixed32(&record, static_cast<uint32_t>(value.size()));
+  EncodeFixed32(&record[0], RecordChecksum(record.data() + 4, key, value));
+  record.append(key);
+  record.append(value);
+  mutex_.Unlock();
+  Status s = file_->Write(SegmentOffset(segment) + offset, record);
+  mutex_.Lock();
+  if (s.ok()) {
+    index_[key] = Location{segment, offset, static_cast<size_t>(size)};
+    segment_keys_[segment].push_back(key);
+  }
+}
+
+}  // namespace titandb
+}  // namespace rocksdb
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "rocksdb/env.h"
+#include "util/mutexlock.h"
+
+#include "blob_cache_admission.h"
+#include "util.h"
+
+namespace rocksdb {
+namespace titandb {
+
+// A persistent cache of blob records in a local file, e.g. on an SSD
+// faster than the volume of the blob files. The file is split into
+// segments filled in turn as a ring, and reusing a segment evicts all
+// records in it. The index is rebuilt from the file when it is opened,
+// so the cache survives restarts. Keys must always map to the same
+// record, which the cache keys of blob records do. Records are written
+// by a background thread, so that reads don't wait for the cache file.
+class BlobFlashCache {
+ public:
+  // Opens the cache file at "path", creating it if missing. A file laid
+  // out for another capacity is reset.
+  static Status Open(Env* env, const std::string& path, uint64_t capacity,
+                     std::shared_ptr<BlobFlashCache>* result);
+
+  BlobFlashCache(const BlobFlashCache&) = delete;
+  BlobFlashCache& operator=(const BlobFlashCache&) = delete;
+
+  // Finishes the writes queued so far.
+  ~BlobFlashCache();
+
+  // Looks up "key". On a hit, sets "*value" to the record read from the
+  // file and returns true. Records failing their checksum are dropped.
+  bool Lookup(const Slice& key, OwnedSlice* value);
+
+  // Records a read of "key" from a blob file, and queues "value" for it
+  // to be written into the cache if the key was read before recently.
+  // Records that are only read once are not worth the write. Records are
+  // dropped while a segment's worth of them is already queued.
+  void Insert(const Slice& key, const Slice& value);
+
+ private:
+  struct Location {
+    uint32_t segment;
+    uint64_t offset;
+    size_t size;
+  };
+
+  struct PendingRecord {
+    std::string key;
+    std::string value;
+  };
+
+  BlobFlashCache(std::unique_ptr<RandomRWFile> file, uint64_t segment_size,
+                 uint32_t num_segments);
+
+  // Writes the file header, or rebuilds the index if it is already there.
+  Status Recover(uint64_t file_size);
+
+  // Indexes the records of "segment".
+  Status RecoverSegment(uint32_t segment);
+
+  // Writes the queued records until the cache is destroyed.
+  void BackgroundWrite();
+
+  // Appends "record" to the segment being filled, starting the next one
+  // if it is full. Only called by the background thread, so that writes
+  // to the file never overlap.
+  // REQUIRES: mutex_ held, released during the I/O
+  void WriteRecord(const PendingRecord& record);
+
+  // Starts refilling "segment", evicting its records. Sets "*header" to
+  // the segment header to write.
+  // REQUIRES: mutex_ held
+  void StartSegment(uint32_t segment, std::string* header);
+
+  uint64_t SegmentOffset(uint32_t segment) const;
+
+  std::unique_ptr<RandomRWFile> file_;
+  const uint64_t segment_size_;
+  const uint32_t num_segments_;
+  FrequencySketch sketch_;
+
+  port::Mutex mutex_;
+  std::unordered_map<std::string, Location> index_;
+  // Keys of the records in every segment, and the sequence number it was
+  // last started with.
+  std::vector<std::vector<std::string>> segment_keys_;
+  std::vector<uint64_t> segment_seqs_;
+  // The segment being filled and where its next record goes.
+  uint32_t segment_;
+  uint64_t write_offset_;
+  uint64_t seq_{0};
+  // Records waiting for the background thread, and their encoded size.
+  std::deque<PendingRecord> pending_;
+  uint64_t pending_bytes_{0};
+  bool closing_{false};
+  port::CondVar pending_cv_;
+  port::Thread writer_;
+};
+
+}  // namespace titandb
+}  // namespace rocksdb
@@ -15,6 +15,42 @@ bool GetChar(Slice* src, unsigned char* value) {
   return true;
 }
 
+// Width code of the compact blob index, see BlobIndex.
+unsigned char FixedWidthCode(uint64_t value) {
+  if (value <= 0xff) return 0;
+  if (value <= 0xffff) return 1;
+  if (value <= 0xffffffff) return 2;
+  return 3;
+}
+
+void PutFixedWidth(std::string* dst, uint64_t value, unsigned char code) {
+  char buf[sizeof(uint64_t)];
+  EncodeFixed64(buf, value);
+  dst->append(buf, size_t{1} << code);
+}
+
+bool GetFixedWidth(Slice* src, unsigned char code, uint64_t* value) {
+  size_t width = size_t{1} << code;
+  if (src->size() < width) return false;
+  const char* p = src->data();
+  switch (code) {
+    case 0:
+      *value = static_cast<unsigned char>(*p);
+      break;
+    case 1:
+      *value = DecodeFixed16(p);
+      break;
+    case 2:
+      *value = DecodeFixed32(p);
+      break;
+    default:
+      *value = DecodeFixed64(p);
+      break;
+  }
+  src->remove_prefix(width);
+  return true;
+}
+
 }  // namespace
 
 void BlobRecord::EncodeTo(std::string* dst) const {
@@ -62,30 +98,52 @@ void BlobEncoder::EncodeRecord(const BlobRecord& record) {
 }
 
 Status BlobDecoder::DecodeHeader(Slice* src) {
-  if (!GetFixed32(src, &crc_)) {
+  if (!GetFixed32(src, &crc_) || src->size() < sizeof(header_)) {
     return Status::Corruption("BlobHeader");
   }
-  header_crc_ = crc32c::Value(src->data(), kRecordHeaderSize - 4);
+  memcpy(header_, src->data(), sizeof(header_));
 
   unsigned char compression;
   if (!GetFixed32(src, &record_size_) || !GetChar(src, &compression)) {
     return Status::Corruption("BlobHeader");
   }
   compression_ = static_cast<CompressionType>(compression);
+  record_data_ = src->data();
+
+  return Status::OK();
+}
 
+Status BlobDecoder::VerifyChecksum(const Slice& src, TitanStats* stats) {
+  TEST_SYNC_POINT_CALLBACK("BlobDecoder::VerifyChecksum", &crc_);
+  if (src.size() < record_size_) {
+    return Status::Corruption("BlobRecord", "record is truncated");
+  }
+  uint64_t start_nanos = stats ? Env::Default()->NowNanos() : 0;
+  uint32_t crc;
+  if (src.data() == record_data_) {
+    crc = crc32c::Value(src.data() - sizeof(header_),
+                        sizeof(header_) + record_size_);
+  } else {
+    crc = crc32c::Value(header_, sizeof(header_));
+    crc = crc32c::Extend(crc, src.data(), record_size_);
+  }
+  if (stats) {
+    stats->recordTick(TitanStats::BLOB_CHECKSUM_VERIFY_NANOS,
+                      Env::Default()->NowNanos() - start_nanos);
+    stats->recordTick(crc == crc_ ? TitanStats::BLOB_CHECKSUM_VERIFIED
+                                  : TitanStats::BLOB_CHECKSUM_MISMATCH,
+                      1);
+  }
+  if (crc != crc_) {
+    return Status::Corruption("BlobRecord", "checksum mismatch");
+  }
   return Status::OK();
 }
 
 Status BlobDecoder::DecodeRecord(Slice* src, BlobRecord* record,
                                  OwnedSlice* buffer) {
-  TEST_SYNC_POINT_CALLBACK("BlobDecoder::DecodeRecord", &crc_);
-
   Slice input(src->data(), record_size_);
   src->remove_prefix(record_size_);
-  // uint32_t crc = crc32c::Extend(header_crc_, input.data(), input.size());
-  // if (crc != crc_) {
-  // return Status::Corruption("BlobRecord", "checksum mismatch");
-  // }
 
   if (compression_ == kNoCompression) {
     return DecodeInto(input, record);
@@ -115,18 +173,73 @@ bool operator==(const BlobHandle& lhs, const BlobHandle& rhs) {
   return lhs.offset == rhs.offset && lhs.size == rhs.size;
 }
 
-void BlobIndex::EncodeTo(std::string* dst) const {
-  dst->push_back(kBlobRecord);
-  PutVarint64(dst, file_number);
-  blob_handle.EncodeTo(dst);
+void BlobIndex::EncodeTo(std::string* dst, bool compact) const {
+  if (chunked) {
+    dst->push_back(kChunkedBlobRecord);
+    PutVarint64(dst, file_number);
+    blob_handle.EncodeTo(dst);
+    PutVarint64(dst, value_size);
+    PutVarint64(dst, chunk_table_size);
+    return;
+  }
+  if (!compact || !has_value_size) {
+    dst->push_back(kBlobRecord);
+    PutVarint64(dst, file_number);
+    blob_handle.EncodeTo(dst);
+    return;
+  }
+  unsigned char file_number_code = FixedWidthCode(file_number);
+  unsigned char offset_code = FixedWidthCode(blob_handle.offset);
+  unsigned char size_code = FixedWidthCode(blob_handle.size);
+  unsigned char value_size_code = FixedWidthCode(value_size);
+  dst->push_back(compressed ? kCompactCompressedBlobRecord
+                            : kCompactBlobRecord);
+  dst->push_back(static_cast<char>(file_number_code | offset_code << 2 |
+                                   size_code << 4 | value_size_code << 6));
+  PutFixedWidth(dst, file_number, file_number_code);
+  PutFixedWidth(dst, blob_handle.offset, offset_code);
+  PutFixedWidth(dst, blob_handle.size, size_code);
+  PutFixedWidth(dst, value_size, value_size_code);
 }
 
 Status BlobIndex::DecodeFrom(Slice* src) {
   unsigned char type;
-  if (!GetChar(src, &type) || type != kBlobRecord ||
-      !GetVarint64(src, &file_number)) {
+  if (!GetChar(src, &type)) {
+    return Status::Corruption("BlobIndex");
+  }
+  if (type == kCompactBlobRecord || type == kCompactCompressedBlobRecord) {
+    unsigned char layout;
+    if (!GetChar(src, &layout) ||
+        !GetFixedWidth(src, layout & 3, &file_number) ||
+        !GetFixedWidth(src, (layout >> 2) & 3, &blob_handle.offset) ||
+        !GetFixedWidth(src, (layout >> 4) & 3, &blob_handle.size) ||
+        !GetFixedWidth(src, (layout >> 6) & 3, &value_size)) {
+      return Status::Corruption("BlobIndex");
+    }
+    has_value_size = true;
+    compressed = type == kCompactCompressedBlobRecord;
+    chunked = false;
+    return Status::OK();
+  }
+  if (type == kChunkedBlobRecord) {
+    if (!GetVarint64(src, &file_number) || !blob_handle.DecodeFrom(src).ok() ||
+        !GetVarint64(src, &value_size) ||
+        !GetVarint64(src, &chunk_table_size) ||
+        chunk_table_size > blob_handle.size) {
+      return Status::Corruption("BlobIndex");
+    }
+    has_value_size = true;
+    compressed = false;
+    chunked = true;
+    return Status::OK();
+  }
+  if (type != kBlobRecord || !GetVarint64(src, &file_number)) {
     return Status::Corruption("BlobIndex");
   }
+  has_value_size = false;
+  compressed = false;
+  chunked = false;
+  value_size = 0;
   Status s = blob_handle.DecodeFrom(src);
   if (!s.ok()) {
     return Status::Corruption("BlobIndex", s.ToString());
@@ -139,6 +252,33 @@ bool operator==(const BlobIndex& lhs, const BlobIndex& rhs) {
           lhs.blob_handle == rhs.blob_handle);
 }
 
+void BlobChunkTable::EncodeTo(std::string* dst) const {
+  PutVarint64(dst, chunk_size);
+  for (uint64_t size : record_sizes) {
+    PutVarint64(dst, size);
+  }
+}
+
+Status BlobChunkTable::DecodeFrom(Slice* src) {
+  if (!GetVarint64(src, &chunk_size) || chunk_size == 0) {
+    return Status::Corruption("BlobChunkTable");
+  }
+  record_sizes.clear();
+  while (!src->empty()) {
+    uint64_t size;
+    if (!GetVarint64(src, &size) || size <= kRecordHeaderSize) {
+      return Status::Corruption("BlobChunkTable");
+    }
+    record_sizes.push_back(size);
+  }
+  return Status::OK();
+}
+
+bool operator==(const BlobChunkTable& lhs, const BlobChunkTable& rhs) {
+  return lhs.chunk_size == rhs.chunk_size &&
+         lhs.record_sizes == rhs.record_sizes;
+}
+
 void BlobFileMeta::EncodeTo(std::string* dst) const {
   PutVarint64(dst, file_number_);
   PutVarint64(dst, file_size_);
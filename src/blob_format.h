@@ -1,5 +1,7 @@
 #pragma once
 
+#include <vector>
+
 #include "rocksdb/options.h"
 #include "rocksdb/slice.h"
 #include "rocksdb/status.h"
@@ -32,6 +34,8 @@ const uint64_t kRecordHeaderSize = 9;
 const uint64_t kBlobFooterSize = BlockHandle::kMaxEncodedLength + 8 + 4;
 const uint32_t kSorted = 0;
 const uint32_t kUnSorted = 1;
+// Holds the chunks of a single value, see BlobChunkTable.
+const uint32_t kChunked = 2;
 
 // Format of blob record (not fixed size):
 //
@@ -66,6 +70,9 @@ class BlobEncoder {
 
   Slice GetHeader() const { return Slice(header_, sizeof(header_)); }
   Slice GetRecord() const { return record_; }
+  CompressionType GetCompression() const {
+    return static_cast<CompressionType>(header_[8]);
+  }
 
   size_t GetEncodedSize() const { return sizeof(header_) + record_.size(); }
 
@@ -84,11 +91,20 @@ class BlobDecoder {
   Status DecodeHeader(Slice *src);
   Status DecodeRecord(Slice *src, BlobRecord *record, OwnedSlice *buffer);
 
+  // Verifies the checksum of the record at the start of "src", which must
+  // be called before DecodeRecord. If the record directly follows the
+  // header it was decoded from, both are checksummed in one pass. The
+  // outcome and the time spent are recorded in "stats" if not null.
+  Status VerifyChecksum(const Slice &src, TitanStats *stats = nullptr);
+
   size_t GetRecordSize() const { return record_size_; }
 
  private:
   uint32_t crc_{0};
-  uint32_t header_crc_{0};
+  // The checksummed part of the header, i.e. size and compression.
+  char header_[kRecordHeaderSize - 4];
+  // Where the record starts if it follows the decoded header in memory.
+  const char *record_data_{nullptr};
   uint32_t record_size_{0};
   CompressionType compression_{kNoCompression};
 };
@@ -119,19 +135,106 @@ struct BlobHandle {
 //    | char |  Varint64   | Varint64(offsest) + Varint64(size) |
 //    +------+-------------+------------------------------------+
 //
+// Format of compact blob index (not fixed size):
+//
+//    +------+--------+-------------+--------+------+------------+
+//    | type | layout | file number | offset | size | value size |
+//    +------+--------+-------------+--------+------+------------+
+//    | char |  char  |    Fixed    | Fixed  | Fixed|   Fixed    |
+//    +------+--------+-------------+--------+------+------------+
+//
+// The type tells whether the record is compressed. Each two bits of the
+// layout, from the lowest ones, give the width of a following field: 1, 2,
+// 4 or 8 bytes. The fields are decoded without looking at every byte, and
+// the value of an uncompressed record can be read without its header.
+//
+// Format of chunked blob index (not fixed size):
+//
+//    +------+-------------+-------------+------------+------------+
+//    | type | file number | blob handle | value size | table size |
+//    +------+-------------+-------------+------------+------------+
+//    | char |  Varint64   | 2 Varint64  |  Varint64  |  Varint64  |
+//    +------+-------------+-------------+------------+------------+
+//
+// The handle covers the records of all chunks of the value and the record
+// of its chunk table, which comes last and takes "table size" bytes.
+//
 // It is stored in LSM-Tree as the value of key, then Titan can use this blob
 // index to locate actual value from blob file.
 struct BlobIndex {
   enum Type : unsigned char {
     kBlobRecord = 1,
+    kCompactBlobRecord = 2,
+    kCompactCompressedBlobRecord = 3,
+    kChunkedBlobRecord = 4,
   };
   uint64_t file_number{0};
   BlobHandle blob_handle;
+  // Known if "has_value_size" is set, which the compact format requires.
+  // "value_size" is the size of the value before compression.
+  bool has_value_size{false};
+  bool compressed{false};
+  uint64_t value_size{0};
+  // Set if the value is stored in chunks, see BlobChunkTable.
+  bool chunked{false};
+  uint64_t chunk_table_size{0};
+
+  // Encodes in the compact format if "compact" is set and the value size
+  // is known. Chunked indexes have a format of their own.
+  void EncodeTo(std::string *dst, bool compact = false) const;
+  Status DecodeFrom(Slice *src);
+
+  // Returns the size of the value if it makes up the last bytes of the
+  // record as is, otherwise zero.
+  uint64_t RawValueSize() const {
+    return has_value_size && !compressed && !chunked ? value_size : 0;
+  }
+
+  // Returns where the record of the chunk table of a chunked value is.
+  BlobHandle ChunkTableHandle() const {
+    BlobHandle handle;
+    handle.offset = blob_handle.offset + blob_handle.size - chunk_table_size;
+    handle.size = chunk_table_size;
+    return handle;
+  }
+
+  // Returns the size of the value if known. Otherwise returns the size of
+  // the stored record without its header. That is an upper bound of the
+  // value size for an uncompressed record: it still counts the key and
+  // the length prefixes.
+  uint64_t EstimatedValueSize() const {
+    if (has_value_size) return value_size;
+    return blob_handle.size > kRecordHeaderSize
+               ? blob_handle.size - kRecordHeaderSize
+               : 0;
+  }
+
+  friend bool operator==(const BlobIndex &lhs, const BlobIndex &rhs);
+};
+
+// Format of chunk table (not fixed size):
+//
+//    +------------+--------------+-----+--------------+
+//    | chunk size | chunk 1 size | ... | chunk N size |
+//    +------------+--------------+-----+--------------+
+//    |  Varint64  |   Varint64   |     |   Varint64   |
+//    +------------+--------------+-----+--------------+
+//
+// A value too large to be read or written at once is split into chunks,
+// each stored as a blob record keyed by the key of the value. The records
+// follow each other in a blob file of their own, and are followed by a
+// record holding the chunk table. The sizes of the chunks are those of
+// their records, header included. Every chunk but the last holds "chunk
+// size" bytes of the value.
+struct BlobChunkTable {
+  uint64_t chunk_size{0};
+  std::vector<uint64_t> record_sizes;
 
   void EncodeTo(std::string *dst) const;
   Status DecodeFrom(Slice *src);
 
-  friend bool operator==(const BlobIndex &lhs, const BlobIndex &rhs);
+  friend bool operator==(const BlobChunkTable &lhs,
+                         const BlobChunkTable &rhs);
 };
 
 // Format of blob file meta (not fixed size):
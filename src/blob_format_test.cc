@@ -34,6 +34,85 @@ TEST(BlobFormatTest, BlobIndex) {
   CheckCodec(input);
 }
 
+TEST(BlobFormatTest, CompactBlobIndex) {
+  BlobIndex input;
+  input.file_number = 1;
+  input.blob_handle.offset = 1 << 20;
+  input.blob_handle.size = 300;
+  input.has_value_size = true;
+  input.value_size = 280;
+  std::string compact;
+  input.EncodeTo(&compact, true /*compact*/);
+  // type + layout + 1 + 4 + 2 + 2 bytes
+  ASSERT_EQ(11, compact.size());
+  std::string legacy;
+  input.EncodeTo(&legacy);
+
+  BlobIndex output;
+  Slice src(compact);
+  ASSERT_OK(output.DecodeFrom(&src));
+  ASSERT_TRUE(src.empty());
+  ASSERT_EQ(input, output);
+  ASSERT_TRUE(output.has_value_size);
+  ASSERT_FALSE(output.compressed);
+  ASSERT_EQ(280, output.RawValueSize());
+
+  input.compressed = true;
+  input.file_number = uint64_t{1} << 40;
+  compact.clear();
+  input.EncodeTo(&compact, true /*compact*/);
+  src = compact;
+  ASSERT_OK(output.DecodeFrom(&src));
+  ASSERT_EQ(input, output);
+  ASSERT_TRUE(output.compressed);
+  ASSERT_EQ(280, output.value_size);
+  ASSERT_EQ(0, output.RawValueSize());
+
+  // Both formats can be decoded into the same index.
+  src = legacy;
+  ASSERT_OK(output.DecodeFrom(&src));
+  ASSERT_FALSE(output.has_value_size);
+  ASSERT_EQ(0, output.RawValueSize());
+  ASSERT_EQ(1, output.file_number);
+
+  compact.pop_back();
+  src = compact;
+  ASSERT_TRUE(output.DecodeFrom(&src).IsCorruption());
+}
+
+TEST(BlobFormatTest, BlobChecksum) {
+  BlobRecord record;
+  record.key = "hello";
+  record.value = "world";
+  BlobEncoder encoder(kNoCompression);
+  encoder.EncodeRecord(record);
+  std::string blob =
+      encoder.GetHeader().ToString() + encoder.GetRecord().ToString();
+
+  // Header and record in one buffer.
+  BlobDecoder decoder;
+  Slice src(blob);
+  ASSERT_OK(decoder.DecodeHeader(&src));
+  ASSERT_OK(decoder.VerifyChecksum(src));
+
+  // Header and record read separately.
+  std::string header = encoder.GetHeader().ToString();
+  std::string body = encoder.GetRecord().ToString();
+  src = header;
+  ASSERT_OK(decoder.DecodeHeader(&src));
+  ASSERT_OK(decoder.VerifyChecksum(body));
+  body[0]++;
+  ASSERT_TRUE(decoder.VerifyChecksum(body).IsCorruption());
+  body.pop_back();
+  ASSERT_TRUE(decoder.VerifyChecksum(body).IsCorruption());
+
+  // The checksum covers the header too.
+  blob[4]++;
+  src = blob;
+  ASSERT_OK(decoder.DecodeHeader(&src));
+  ASSERT_TRUE(decoder.VerifyChecksum(src).IsCorruption());
+}
+
 TEST(BlobFormatTest, BlobFileMeta) {
   BlobFileMeta input(2, 3, 0, 0, "0", "9");
   CheckCodec(input);
@@ -67,6 +146,47 @@ TEST(BlobFormatTest, BlobFileStateTransit) {
   ASSERT_EQ(compaction_output.file_state(), BlobFileMeta::FileState::kNormal);
 }
 
+TEST(BlobFormatTest, ChunkedBlobIndex) {
+  BlobIndex input;
+  input.file_number = 7;
+  input.blob_handle.offset = 8;
+  input.blob_handle.size = 1000;
+  input.has_value_size = true;
+  input.value_size = 900;
+  input.chunked = true;
+  input.chunk_table_size = 40;
+  std::string encoded;
+  input.EncodeTo(&encoded);
+
+  BlobIndex output;
+  Slice src(encoded);
+  ASSERT_OK(output.DecodeFrom(&src));
+  ASSERT_TRUE(src.empty());
+  ASSERT_EQ(input, output);
+  ASSERT_TRUE(output.chunked);
+  ASSERT_EQ(900, output.value_size);
+  ASSERT_EQ(40, output.chunk_table_size);
+  // Never read as a single record.
+  ASSERT_EQ(0, output.RawValueSize());
+  BlobHandle table = output.ChunkTableHandle();
+  ASSERT_EQ(968, table.offset);
+  ASSERT_EQ(40, table.size);
+}
+
+TEST(BlobFormatTest, BlobChunkTable) {
+  BlobChunkTable input;
+  input.chunk_size = 100;
+  CheckCodec(input);
+  input.record_sizes = {130, 130, 50};
+  CheckCodec(input);
+
+  BlobChunkTable output;
+  std::string encoded;
+  PutVarint64(&encoded, 0);
+  Slice src(encoded);
+  ASSERT_TRUE(output.DecodeFrom(&src).IsCorruption());
+}
+
 }  // namespace titandb
 }  // namespace rocksdb
 
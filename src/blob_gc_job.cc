@@ -165,8 +165,22 @@ Status BlobGCJob::Run() {
 
 Status BlobGCJob::SampleCandidateFiles() {
   TitanStopWatch sw(env_, metrics_.gc_sampling_micros);
-  std::vector<BlobFileMeta*> result(blob_gc_->inputs());
-  
+  std::vector<BlobFileMeta*> result;
+  for (auto* file : blob_gc_->inputs()) {
+    if (file->file_type() == kChunked) {
+      // The chunks of a live value are never rewritten, the whole file is
+      // dropped once the value is gone.
+      bool live = false;
+      Status s = IsChunkedValueLive(file, &live);
+      if (!s.ok()) {
+        return s;
+      }
+      if (live) {
+        continue;
+      }
+    }
+    result.push_back(file);
+  }
   blob_gc_->set_sampled_inputs(std::move(result));
   // No need to sample.
   /*
@@ -377,9 +391,10 @@ Status BlobGCJob::DoRunGC() {
     file_size += blob_record.size();
     BlobIndex new_blob_index;
     new_blob_index.file_number = blob_file_handle->GetNumber();
-    blob_file_builder->Add(blob_record, &new_blob_index.blob_handle);
+    blob_file_builder->Add(blob_record, &new_blob_index);
     std::string index_entry;
-    new_blob_index.EncodeTo(&index_entry);
+    new_blob_index.EncodeTo(&index_entry,
+                            blob_gc_->titan_cf_options().compact_blob_index);
 
     // Store WriteBatch for rewriting new Key-Index pairs to LSM
     GarbageCollectionWriteCallback callback(cfh, blob_record.key.ToString(),
@@ -468,6 +483,30 @@ Status BlobGCJob::DiscardEntry(const Slice& key, const BlobIndex& blob_index,
   return Status::OK();
 }
 
+Status BlobGCJob::IsChunkedValueLive(const BlobFileMeta* file, bool* live) {
+  TitanStopWatch sw(env_, metrics_.gc_read_lsm_micros);
+  PinnableSlice index_entry;
+  bool is_blob_index = false;
+  Status s = base_db_impl_->GetImpl(
+      ReadOptions(), blob_gc_->column_family_handle(), file->smallest_key(),
+      &index_entry, nullptr /*value_found*/, nullptr /*read_callback*/,
+      &is_blob_index);
+  if (!s.ok() && !s.IsNotFound()) {
+    return s;
+  }
+  *live = false;
+  if (s.IsNotFound() || !is_blob_index) {
+    return Status::OK();
+  }
+  BlobIndex blob_index;
+  s = DecodeInto(index_entry, &blob_index);
+  if (!s.ok()) {
+    return s;
+  }
+  *live = blob_index.file_number == file->file_number();
+  return Status::OK();
+}
+
 // We have to make sure crash consistency, but LSM db MANIFEST and BLOB db
 // MANIFEST are separate, so we need to make sure all new blob file have
 // added to db before we rewrite any key to LSM
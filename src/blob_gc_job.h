@@ -99,6 +99,9 @@ class BlobGCJob {
   Status BuildIterator(std::unique_ptr<BlobFileMergeIterator>* result);
   Status DiscardEntry(const Slice& key, const BlobIndex& blob_index,
                       bool* discardable);
+  // Sets "*live" if the chunked value held by "file" is still the latest
+  // value of its key.
+  Status IsChunkedValueLive(const BlobFileMeta* file, bool* live);
   Status InstallOutputBlobFiles();
   Status RewriteValidKeyToLSM();
   Status DeleteInputBlobFiles();
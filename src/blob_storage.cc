@@ -26,10 +26,26 @@ bool BlobStorage::ShouldGCLowLevel() {
 
 Status BlobStorage::Get(const ReadOptions &options, const BlobIndex &index,
                         BlobRecord *record, PinnableSlice *buffer) {
-  auto sfile = FindFile(index.file_number).lock();
+  if (index.chunked) {
+    std::unique_ptr<BlobChunkReader> reader;
+    Status s = NewChunkReader(options, index, &reader);
+    if (s.ok()) {
+      s = reader->Read(0, index.value_size, buffer);
+    }
+    if (s.ok()) {
+      record->key = Slice();
+      record->value = *buffer;
+    }
+    return s;
+  }
+  EpochGuard guard;
+  const BlobFileMeta *sfile = FindFileUnlocked(index.file_number);
   if (!sfile) {
     if (db_options_.sep_before_flush) {
-      return ReadBuildingFile(options, index, record);
+      if (options.read_tier == kBlockCacheTier) {
+        return Status::Incomplete("blob file is being built, no I/O allowed");
+      }
+      return ReadBuildingFile(options, index, record, buffer);
     }
     return Status::Corruption("Missing blob file: " +
                               std::to_string(index.file_number));
@@ -40,19 +56,99 @@ Status BlobStorage::Get(const ReadOptions &options, const BlobIndex &index,
     record->only_value = false;
   }
   return file_cache_->Get(options, sfile->file_number(), sfile->file_size(),
-                          index.blob_handle, record, buffer);
+                          index.blob_handle, record, buffer,
+                          index.RawValueSize());
+}
+
+Status BlobStorage::GetPartial(const ReadOptions &options,
+                               const BlobIndex &index, uint64_t offset,
+                               uint64_t len, PinnableSlice *value) {
+  if (index.chunked) {
+    // Only the chunks overlapping the range are read.
+    std::unique_ptr<BlobChunkReader> reader;
+    Status s = NewChunkReader(options, index, &reader);
+    if (s.ok()) {
+      s = reader->Read(offset, len, value);
+    }
+    return s;
+  }
+  EpochGuard guard;
+  const BlobFileMeta *sfile = FindFileUnlocked(index.file_number);
+  if (!sfile) {
+    // Files being built are read in full.
+    BlobRecord record;
+    PinnableSlice buffer;
+    Status s = Get(options, index, &record, &buffer);
+    if (s.ok()) {
+      PinPartialValue(record.value, offset, len, &buffer, value);
+    }
+    return s;
+  }
+  bool only_value = cf_options_.level_merge && sfile->file_type() == kSorted;
+  return file_cache_->GetPartial(options, sfile->file_number(),
+                                 sfile->file_size(), index.blob_handle,
+                                 index.RawValueSize(), only_value, offset,
+                                 len, value);
+}
+
+Status BlobStorage::NewChunkReader(const ReadOptions &options,
+                                   const BlobIndex &index,
+                                   std::unique_ptr<BlobChunkReader> *result) {
+  EpochGuard guard;
+  // Chunks are written into files of their own, which are installed
+  // before the value is, so they are never being built.
+  const BlobFileMeta *sfile = FindFileUnlocked(index.file_number);
+  if (!sfile) {
+    return Status::Corruption("Missing blob file: " +
+                              std::to_string(index.file_number));
+  }
+  return BlobChunkReader::Open(options, file_cache_, sfile->file_number(),
+                               sfile->file_size(), index, result);
+}
+
+void BlobStorage::MultiGet(const ReadOptions &options, uint64_t file_number,
+                           const std::vector<BlobGetRequest *> &requests,
+                           uint64_t min_gap) {
+  EpochGuard guard;
+  const BlobFileMeta *sfile = FindFileUnlocked(file_number);
+  if (!sfile) {
+    for (auto *request : requests) {
+      if (!db_options_.sep_before_flush) {
+        request->status = Status::Corruption("Missing blob file: " +
+                                             std::to_string(file_number));
+      } else if (options.read_tier == kBlockCacheTier) {
+        request->status =
+            Status::Incomplete("blob file is being built, no I/O allowed");
+      } else {
+        BlobIndex index;
+        index.file_number = file_number;
+        index.blob_handle = request->handle;
+        request->status = ReadBuildingFile(options, index, request->record,
+                                           request->buffer);
+      }
+    }
+    return;
+  }
+  bool only_value = cf_options_.level_merge && sfile->file_type() == kSorted;
+  for (auto *request : requests) {
+    request->record->only_value = only_value;
+  }
+  file_cache_->MultiGet(
+      options, sfile->file_number(), sfile->file_size(), requests,
+      std::max(min_gap, cf_options_.blob_read_coalesce_gap));
 }
 
 Status BlobStorage::ReadBuildingFile(const ReadOptions &options,
                                      const BlobIndex &index,
-                                     BlobRecord *record) {
+                                     BlobRecord *record,
+                                     PinnableSlice *buffer) {
   auto reader = FindBuildingFile(index.file_number).lock();
   if (!reader) {
     return Status::Corruption("File " + std::to_string(index.file_number) +
                               " not exist");
   }
   Slice blob;
-  OwnedSlice buffer;
+  OwnedSlice owned;
   CacheAllocationPtr ubuf(new char[index.blob_handle.size]);
   auto s = reader->Read(index.blob_handle.offset, index.blob_handle.size, &blob,
                         ubuf.get());
@@ -70,14 +166,27 @@ Status BlobStorage::ReadBuildingFile(const ReadOptions &options,
   if (!s.ok()) {
     return s;
   }
-  buffer.reset(std::move(ubuf), blob);
-  s = decoder.DecodeRecord(&blob, record, &buffer);
+  if (ShouldVerifyBlobChecksum(cf_options_, false /*for_compaction*/)) {
+    s = decoder.VerifyChecksum(blob, stats_);
+    if (!s.ok()) {
+      return s;
+    }
+  }
+  owned.reset(std::move(ubuf), blob);
+  s = decoder.DecodeRecord(&blob, record, &owned);
+  if (!s.ok()) {
+    return s;
+  }
+  // The record points into "owned", which must outlive this call.
+  Slice data = owned;
+  buffer->PinSlice(data, OwnedSlice::CleanupFunc, owned.release(), nullptr);
   return s;
 }
 
 Status BlobStorage::NewPrefetcher(uint64_t file_number,
                                   std::unique_ptr<BlobFilePrefetcher> *result) {
-  auto sfile = FindFile(file_number).lock();
+  EpochGuard guard;
+  const BlobFileMeta *sfile = FindFileUnlocked(file_number);
   if (!sfile)
     return Status::Corruption("Missing blob wfile: " +
                               std::to_string(file_number));
@@ -159,6 +268,24 @@ void BlobStorage::ExportBlobFiles(
 
 void BlobStorage::AddBlobFile(std::shared_ptr<BlobFileMeta> &file) {
   std::unique_lock<std::mutex> l(mutex_);
+  AddBlobFileLocked(file);
+  PublishFileView();
+}
+
+void BlobStorage::AddBlobFiles(
+    const std::vector<std::shared_ptr<BlobFileMeta>> &files) {
+  if (files.empty()) return;
+  std::unique_lock<std::mutex> l(mutex_);
+  for (auto &file : files) {
+    AddBlobFileLocked(file);
+  }
+  PublishFileView();
+}
+
+void BlobStorage::AddBlobFileLocked(
+    const std::shared_ptr<BlobFileMeta> &file) {
+  // mutex_.AssertHeld();
+
   files_.emplace(std::make_pair(file->file_number(), file));
   blob_ranges_.emplace(std::make_pair(Slice(file->smallest_key()), file));
   AddStats(stats_, cf_id_, TitanInternalStats::LIVE_BLOB_FILE_SIZE,
@@ -169,6 +296,12 @@ void BlobStorage::AddBlobFile(std::shared_ptr<BlobFileMeta> &file) {
   } else {
     level_blob_size_[cf_options_.num_levels].fetch_add(file->file_size());
   }
+  if ((cf_options_.mmap_sorted_blob_files && file->file_type() == kSorted) ||
+      (cf_options_.mmap_blob_file_min_level >= 0 &&
+       static_cast<int>(file->file_level()) >=
+           cf_options_.mmap_blob_file_min_level)) {
+    file_cache_->SetMmapReads(file->file_number());
+  }
   if (db_options_.sep_before_flush) {
     building_files_.erase(file->file_number());
   }
@@ -207,8 +340,8 @@ void BlobStorage::MarkFileObsoleteLocked(std::shared_ptr<BlobFileMeta> file,
                                          SequenceNumber obsolete_sequence) {
   // mutex_.AssertHeld();
 
-  obsolete_files_.push_back(
-      std::make_pair(file->file_number(), obsolete_sequence));
+  obsolete_files_.push_back({file->file_number(), obsolete_sequence,
+                             EpochDomain::Default()->Advance()});
   file->FileStateTransit(BlobFileMeta::FileEvent::kDelete);
   SubStats(stats_, cf_id_, TitanInternalStats::LIVE_BLOB_SIZE,
            file->file_size() - file->discardable_size());
@@ -244,10 +377,14 @@ bool BlobStorage::RemoveFile(uint64_t file_number) {
            file->second->file_size());
   SubStats(stats_, cf_id_, TitanInternalStats::NUM_OBSOLETE_BLOB_FILE, 1);
   files_.erase(file_number);
-  file_cache_->Evict(file_number);
   return true;
 }
 
+void BlobStorage::PublishFileView() {
+  const FileMap *old_view = file_view_.exchange(new FileMap(files_));
+  EpochDomain::Default()->Retire([old_view]() { delete old_view; });
+}
+
 
 
 std::vector<int> CountSortedRun(std::vector<std::shared_ptr<BlobFileMeta>>& files) {
@@ -394,16 +531,21 @@ void BlobStorage::GetObsoleteFiles(std::vector<std::string> *obsolete_files,
 
   uint32_t file_dropped = 0;
   uint64_t file_dropped_size = 0;
+  std::vector<uint64_t> removed_files;
+  uint64_t min_active_epoch = EpochDomain::Default()->MinActiveEpoch();
   for (auto it = obsolete_files_.begin(); it != obsolete_files_.end();) {
-    auto &file_number = it->first;
-    auto &obsolete_sequence = it->second;
+    auto &file_number = it->file_number;
+    auto &obsolete_sequence = it->obsolete_sequence;
     // We check whether the oldest snapshot is no less than the last sequence
     // by the time the blob file become obsolete. If so, the blob file is not
-    // visible to all existing snapshots.
-    if (oldest_sequence > obsolete_sequence) {
+    // visible to all existing snapshots. Reads without a snapshot are
+    // covered by the epoch they entered at instead.
+    if (oldest_sequence > obsolete_sequence &&
+        min_active_epoch > it->obsolete_epoch) {
       // remove obsolete files
       bool __attribute__((__unused__)) removed = RemoveFile(file_number);
       assert(removed);
+      removed_files.push_back(file_number);
       ROCKS_LOG_INFO(db_options_.info_log,
                      "Obsolete blob file %" PRIu64 " (obsolete at %" PRIu64
                      ") not visible to oldest snapshot %" PRIu64 ", delete it.",
@@ -418,6 +560,14 @@ void BlobStorage::GetObsoleteFiles(std::vector<std::string> *obsolete_files,
     }
     ++it;
   }
+
+  if (removed_files.empty()) return;
+  // Publish once for the whole pass, and only evict the readers after the
+  // new view is out so that no lookup reopens a removed file.
+  PublishFileView();
+  for (auto file_number : removed_files) {
+    file_cache_->Evict(file_number);
+  }
 }
 
 size_t BlobStorage::ComputeGCScore() {
@@ -429,6 +579,12 @@ size_t BlobStorage::ComputeGCScore() {
     gc_score_.clear();
 
     for (auto &file : files_) {
+      // The file of a chunked value is only worth a look once the value
+      // may be gone, see BlobGCJob::SampleCandidateFiles.
+      if (file.second->file_type() == kChunked &&
+          file.second->discardable_size() == 0 && !file.second->gc_mark()) {
+        continue;
+      }
       if (file.second->is_obsolete() ||
           (cf_options_.level_merge && (file.second->file_type() == kSorted || file.second->GetDiscardableRatio() <
               cf_options_.blob_file_discardable_ratio))) {
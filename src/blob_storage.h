@@ -3,9 +3,12 @@
 #define __STDC_FORMAT_MACROS
 #endif
 #include <inttypes.h>
+#include "blob_chunk.h"
 #include "blob_file_cache.h"
 #include "blob_format.h"
 #include "blob_gc.h"
+#include "epoch.h"
+#include "hot_value_tracker.h"
 #include "rocksdb/options.h"
 #include "titan_stats.h"
 #include "mutex"
@@ -25,6 +28,8 @@ class BlobStorage {
     this->env_options_ = bs.env_options_;
     this->cf_id_ = bs.cf_id_;
     this->stats_ = bs.stats_;
+    this->hot_values_ = bs.hot_values_;
+    this->file_view_.store(new FileMap(files_));
   }
 
   BlobStorage(const TitanDBOptions& _db_options,
@@ -38,12 +43,21 @@ class BlobStorage {
         file_cache_(_file_cache),
         destroyed_(false),
         stats_(stats),
-        level_blob_size_(cf_options_.num_levels+1) {}
+        level_blob_size_(cf_options_.num_levels+1),
+        file_view_(new FileMap()) {
+    if (cf_options_.hot_value_inline_budget > 0) {
+      hot_values_ = std::make_shared<HotValueTracker>(
+          cf_options_.hot_value_inline_budget,
+          cf_options_.hot_value_sample_rate);
+    }
+  }
 
   ~BlobStorage() {
     for (auto& file : files_) {
       file_cache_->Evict(file.second->file_number());
     }
+    // No reader can be left once the storage itself is reclaimed.
+    delete file_view_.load();
   }
 
   const TitanDBOptions& db_options() { return db_options_; }
@@ -59,10 +73,43 @@ class BlobStorage {
 
   // Gets the blob record pointed by the blob index. The provided
   // buffer is used to store the record data, so the buffer must be
-  // valid when the record is used.
+  // valid when the record is used. A chunked value is read as a whole,
+  // leaving the key of the record empty.
   Status Get(const ReadOptions& options, const BlobIndex& index,
              BlobRecord* record, PinnableSlice* buffer);
 
+  // Gets part of the value pointed by the blob index into "value", see
+  // TitanDB::GetPartial.
+  Status GetPartial(const ReadOptions& options, const BlobIndex& index,
+                    uint64_t offset, uint64_t len, PinnableSlice* value);
+
+  // Opens the chunked value pointed by the blob index to be read chunk by
+  // chunk.
+  Status NewChunkReader(const ReadOptions& options, const BlobIndex& index,
+                        std::unique_ptr<BlobChunkReader>* result);
+
+  // Gets the blob records of a batch of requests which all point into the
+  // blob file "file_number". Records close to each other are fetched with
+  // a single read, see blob_read_coalesce_gap; "min_gap" widens the gap.
+  void MultiGet(const ReadOptions& options, uint64_t file_number,
+                const std::vector<BlobGetRequest*>& requests,
+                uint64_t min_gap = 0);
+
+  // Records a read of a value of "value_size" bytes of "key", which may
+  // make it hot, see TitanCFOptions::hot_value_inline_budget.
+  void RecordRead(const Slice& key, uint64_t value_size) {
+    if (hot_values_ && value_size >= cf_options_.min_blob_size &&
+        value_size <= cf_options_.hot_value_max_size) {
+      hot_values_->RecordRead(key, value_size);
+    }
+  }
+
+  // Returns true if the value of "key" is hot and should be kept in the
+  // SST by compaction.
+  bool IsHotValue(const Slice& key) const {
+    return hot_values_ && hot_values_->IsHot(key);
+  }
+
   // Creates a prefetcher for the specified file number.
   Status NewPrefetcher(uint64_t file_number,
                        std::unique_ptr<BlobFilePrefetcher>* result);
@@ -75,6 +122,16 @@ class BlobStorage {
   // corruption if the file doesn't exist.
   std::weak_ptr<BlobFileMeta> FindFile(uint64_t file_number) const;
 
+  // Same as FindFile, but takes no lock and touches no refcount. Returns
+  // nullptr if the file doesn't exist. The meta stays valid until the
+  // caller leaves its EpochGuard.
+  // REQUIRE: inside an EpochGuard
+  const BlobFileMeta* FindFileUnlocked(uint64_t file_number) const {
+    const FileMap* view = file_view_.load(std::memory_order_acquire);
+    auto it = view->find(file_number);
+    return it != view->end() ? it->second.get() : nullptr;
+  }
+
   bool ShouldGCLowLevel();
 
   std::weak_ptr<RandomAccessFileReader> FindBuildingFile(
@@ -110,10 +167,15 @@ class BlobStorage {
   // Add a new blob file to this blob storage.
   void AddBlobFile(std::shared_ptr<BlobFileMeta>& file);
 
+  // Add new blob files to this blob storage, publishing the file view to
+  // lock-free readers once for the whole batch.
+  void AddBlobFiles(const std::vector<std::shared_ptr<BlobFileMeta>>& files);
+
   Status AddBuildingFile(uint64_t file_number);
 
   // Gets all obsolete blob files whose obsolete_sequence is smaller than the
-  // oldest_sequence. Note that the files returned would be erased from internal
+  // oldest_sequence and that no snapshot-free reader in flight may still
+  // read. Note that the files returned would be erased from internal
   // structure, so for the next call, the files returned before wouldn't be
   // returned again.
   void GetObsoleteFiles(std::vector<std::string>* obsolete_files,
@@ -140,8 +202,10 @@ class BlobStorage {
   void ExportBlobFiles(
       std::map<uint64_t, std::weak_ptr<BlobFileMeta>>& ret) const;
 
+  // Reads a record from a blob file that is still being built. The record
+  // data is pinned in "buffer".
   Status ReadBuildingFile(const ReadOptions& options, const BlobIndex& index,
-                          BlobRecord* record);
+                          BlobRecord* record, PinnableSlice* buffer);
 
  private:
   friend class BlobFileSet;
@@ -152,8 +216,20 @@ class BlobStorage {
 
   void MarkFileObsoleteLocked(std::shared_ptr<BlobFileMeta> file,
                               SequenceNumber obsolete_sequence);
+  // REQUIRE: mutex_ held
+  void AddBlobFileLocked(const std::shared_ptr<BlobFileMeta>& file);
+  // Does not publish the file view nor evict the file's reader, the caller
+  // does both once it is done removing files.
+  // REQUIRE: mutex_ held
   bool RemoveFile(uint64_t file_number);
 
+  using FileMap = std::unordered_map<uint64_t, std::shared_ptr<BlobFileMeta>>;
+
+  // Publishes a copy of files_ to lock-free readers and retires the old
+  // one.
+  // REQUIRE: mutex_ held
+  void PublishFileView();
+
   TitanDBOptions db_options_;
   TitanCFOptions cf_options_;
   EnvOptions env_options_;
@@ -191,7 +267,14 @@ class BlobStorage {
 
   std::vector<GCScore> gc_score_;
 
-  std::list<std::pair<uint64_t, SequenceNumber>> obsolete_files_;
+  struct ObsoleteFile {
+    uint64_t file_number;
+    SequenceNumber obsolete_sequence;
+    // Epoch the file became obsolete at. Readers without a snapshot that
+    // entered no later than this may still hold a blob index into it.
+    uint64_t obsolete_epoch;
+  };
+  std::list<ObsoleteFile> obsolete_files_;
   // It is marked when the column family handle is destroyed, indicating the
   // in-memory data structure can be destroyed. Physical files may still be
   // kept.
@@ -199,7 +282,14 @@ class BlobStorage {
 
   TitanStats* stats_;
 
+  // Null if hot values are not inlined. Shared with copies of this storage.
+  std::shared_ptr<HotValueTracker> hot_values_;
+
   std::vector<std::atomic<uint64_t>> level_blob_size_;
+
+  // Immutable copy of files_ read by FindFileUnlocked. Replaced as a whole
+  // whenever files_ changes.
+  std::atomic<const FileMap*> file_view_;
 };
 
 }  // namespace titandb
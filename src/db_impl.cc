@@ -6,6 +6,7 @@
 
 #include <inttypes.h>
 
+#include "db/write_batch_internal.h"
 #include "logging/log_buffer.h"
 #include "port/port.h"
 #include "util/autovector.h"
@@ -43,8 +44,6 @@ std::atomic<uint64_t> gc_mark_file{0};
 namespace rocksdb {
 namespace titandb {
 
-// ThreadPool* TitanDBIterator::pool_ = new ThreadPool(32);
-
 class TitanDBImpl::FileManager : public BlobFileManager {
  public:
   FileManager(TitanDBImpl* db) : db_(db) {}
@@ -168,6 +167,9 @@ TitanDBImpl::TitanDBImpl(const TitanDBOptions& options,
   if (db_options_.statistics != nullptr) {
     stats_.reset(new TitanStats(db_options_.statistics.get()));
   }
+  if (db_options_.titan_row_cache != nullptr) {
+    row_cache_.reset(new RowCache(db_options_.titan_row_cache));
+  }
   blob_manager_.reset(new FileManager(this));
 }
 
@@ -190,6 +192,23 @@ void TitanDBImpl::StartBackgroundTasks() {
         [this]() { TitanDBImpl::DumpStats(); }, "titanst", env_,
         db_options_.titan_stats_dump_period_sec * 1000 * 1000));
   }
+  if (thread_dump_hot_blobs_ == nullptr &&
+      db_options_.blob_cache_dump_period_sec > 0) {
+    warmup_thread_ = port::Thread(
+        [this]() { blob_file_set_->WarmUpBlobCache(&shuting_down_); });
+    thread_dump_hot_blobs_.reset(new rocksdb::RepeatableThread(
+        [this]() { TitanDBImpl::DumpHotBlobs(); }, "titanhb", env_,
+        static_cast<uint64_t>(db_options_.blob_cache_dump_period_sec) *
+            1000 * 1000));
+  }
+}
+
+void TitanDBImpl::DumpHotBlobs() {
+  Status s = blob_file_set_->DumpHotBlobs();
+  if (!s.ok()) {
+    ROCKS_LOG_WARN(db_options_.info_log, "Failed to dump hot blobs: %s",
+                   s.ToString().c_str());
+  }
 }
 
 Status TitanDBImpl::ValidateOptions(
@@ -268,6 +287,9 @@ Status TitanDBImpl::Open(const std::vector<TitanCFDescriptor>& descs,
                            {cf_name, ImmutableTitanCFOptions(descs[i].options),
                             MutableTitanCFOptions(descs[i].options),
                             base_table_factory, titan_table_factory}));
+      if (descs[i].options.hot_value_inline_budget > 0) {
+        track_hot_values_.store(true, std::memory_order_relaxed);
+      }
       // builders_.emplace(cf_id,
       // ForegroundBuilder(cf_id,
       // blob_manager_,blob_file_set_->GetBlobStorage(cf_id) ,db_options_,
@@ -300,6 +322,10 @@ Status TitanDBImpl::Open(const std::vector<TitanCFDescriptor>& descs,
   }
   if (!s.ok()) return s;
 
+  if (db_options_.num_blob_read_threads > 0) {
+    read_pool_.reset(new ThreadPool(db_options_.num_blob_read_threads));
+  }
+
   // Initialize GC thread pool.
   if (!db_options_.disable_background_gc && db_options_.max_background_gc > 0) {
     env_->IncBackgroundThreadsIfNeeded(db_options_.max_background_gc,
@@ -387,6 +413,17 @@ Status TitanDBImpl::CloseImpl() {
     mutex_.Unlock();
   }
 
+  // The warm-up stops early as shuting_down_ is set.
+  if (warmup_thread_.joinable()) {
+    warmup_thread_.join();
+  }
+  if (thread_dump_hot_blobs_ != nullptr) {
+    thread_dump_hot_blobs_->cancel();
+    thread_dump_hot_blobs_.reset();
+    // Leaves the latest hot blobs for the next open.
+    DumpHotBlobs();
+  }
+
   return Status::OK();
 }
 
@@ -426,6 +463,9 @@ Status TitanDBImpl::CreateColumnFamilies(
                 {handle->GetName(), ImmutableTitanCFOptions(descs[i].options),
                  MutableTitanCFOptions(descs[i].options), base_table_factory[i],
                  titan_table_factory[i]}));
+        if (descs[i].options.hot_value_inline_budget > 0) {
+          track_hot_values_.store(true, std::memory_order_relaxed);
+        }
       }
       blob_file_set_->AddColumnFamilies(column_families);
     }
@@ -542,8 +582,9 @@ Status TitanDBImpl::CompactFiles(
   return s;
 }
 
-int TitanDBImpl::Scan(const ReadOptions& options, const std::string& start_key,
-                      int len, std::vector<std::string>& keys,
+int TitanDBImpl::Scan(const TitanReadOptions& options,
+                      const std::string& start_key, int len,
+                      std::vector<std::string>& keys,
                       std::vector<std::string>& vals) {
   if ((int)keys.size() < len) keys.resize(len);
   if ((int)vals.size() < len) vals.resize(len);
@@ -575,37 +616,224 @@ Status TitanDBImpl::Put(const rocksdb::WriteOptions& options,
     std::cerr<<"wait done\n";
     }
   }
+  uint64_t chunked_value_min_size = 0;
+  {
+    EpochGuard guard;
+    BlobStorage* storage =
+        blob_file_set_->GetBlobStorageUnlocked(column_family->GetID());
+    if (storage) {
+      chunked_value_min_size = storage->cf_options().chunked_value_min_size;
+    }
+  }
+  if (chunked_value_min_size > 0 && value.size() >= chunked_value_min_size) {
+    return WriteChunkedValue(options, column_family, key,
+                             [&value](BlobChunkWriter* writer) {
+                               writer->Append(value);
+                               return Status::OK();
+                             });
+  }
   // if (db_options_.sep_before_flush && value.size() >
   // cf_info_[column_family->GetID()].immutable_cf_options.mid_blob_size) {
+  Status s;
   if (db_options_.sep_before_flush) {
     auto wb = WriteBatch();
     if (builders_[column_family->GetID()].Add(key, value, &wb).ok()) {
-      return db_->Write(options, &wb);
+      s = db_->Write(options, &wb);
+    } else {
+      s = db_->Put(options, column_family, key, value);
     }
-    return db_->Put(options, column_family, key, value);
   } else {
-    return db_->Put(options, column_family, key, value);
+    s = db_->Put(options, column_family, key, value);
+  }
+  if (row_cache_) {
+    row_cache_->Invalidate(column_family->GetID(), key);
+  }
+  return s;
+}
+
+Status TitanDBImpl::PutStream(const WriteOptions& options,
+                              ColumnFamilyHandle* column_family,
+                              const Slice& key, SequentialFile* source) {
+  if (HasBGError()) return GetBGError();
+  return WriteChunkedValue(
+      options, column_family, key, [source](BlobChunkWriter* writer) {
+        const size_t kReadSize = 64 << 10;
+        std::unique_ptr<char[]> scratch(new char[kReadSize]);
+        while (true) {
+          Slice data;
+          Status s = source->Read(kReadSize, &data, scratch.get());
+          if (!s.ok()) {
+            return s;
+          }
+          if (data.empty()) {
+            return Status::OK();
+          }
+          writer->Append(data);
+        }
+      });
+}
+
+Status TitanDBImpl::WriteChunkedValue(
+    const WriteOptions& options, ColumnFamilyHandle* column_family,
+    const Slice& key, const std::function<Status(BlobChunkWriter*)>& fill) {
+  uint32_t cf_id = column_family->GetID();
+  std::shared_ptr<BlobStorage> storage;
+  {
+    MutexLock l(&mutex_);
+    storage = blob_file_set_->GetBlobStorage(cf_id).lock();
+  }
+  if (!storage) {
+    return Status::NotFound("Column family id: " + std::to_string(cf_id) +
+                            " not Found.");
+  }
+
+  std::unique_ptr<BlobFileHandle> handle;
+  Status s = blob_manager_->NewFile(&handle);
+  if (!s.ok()) return s;
+  BlobIndex index;
+  uint64_t num_entries = 0;
+  {
+    BlobFileBuilder builder(db_options_, storage->cf_options(),
+                            handle->GetFile());
+    BlobChunkWriter writer(&builder, key,
+                           storage->cf_options().blob_chunk_size);
+    s = fill(&writer);
+    if (s.ok()) {
+      s = writer.Finish(&index);
+    }
+    if (s.ok()) {
+      s = builder.Finish();
+    }
+    num_entries = builder.NumEntries();
+  }
+  if (!s.ok()) {
+    blob_manager_->DeleteFile(std::move(handle));
+    return s;
+  }
+  index.file_number = handle->GetNumber();
+  auto file = std::make_shared<BlobFileMeta>(
+      index.file_number, handle->GetFile()->GetFileSize(), num_entries,
+      0 /*file_level*/, key.ToString(), key.ToString(), kChunked);
+  file->FileStateTransit(BlobFileMeta::FileEvent::kFlushOrCompactionOutput);
+  // The chunks are durable before the key points to them.
+  s = blob_manager_->FinishFile(cf_id, file, std::move(handle));
+  if (!s.ok()) return s;
+
+  std::string index_entry;
+  index.EncodeTo(&index_entry);
+  WriteBatch wb;
+  s = WriteBatchInternal::PutBlobIndex(&wb, cf_id, key, index_entry);
+  if (s.ok()) {
+    s = db_->Write(options, &wb);
+  }
+  if (row_cache_) {
+    row_cache_->Invalidate(cf_id, key);
+  }
+  if (s.ok()) {
+    file->FileStateTransit(BlobFileMeta::FileEvent::kFlushCompleted);
+  } else {
+    // Nothing points to the chunks.
+    MutexLock l(&mutex_);
+    VersionEdit edit;
+    edit.SetColumnFamilyID(cf_id);
+    edit.DeleteBlobFile(file->file_number(),
+                        db_impl_->GetLatestSequenceNumber());
+    blob_file_set_->LogAndApply(edit);
   }
+  return s;
 }
 
 Status TitanDBImpl::Write(const rocksdb::WriteOptions& options,
                           rocksdb::WriteBatch* updates) {
-  return HasBGError() ? GetBGError() : db_->Write(options, updates);
+  if (HasBGError()) return GetBGError();
+  Status s = db_->Write(options, updates);
+  if (row_cache_) {
+    InvalidateRowCache(updates);
+  }
+  return s;
+}
+
+void TitanDBImpl::InvalidateRowCache(WriteBatch* updates) {
+  class Invalidator : public WriteBatch::Handler {
+   public:
+    explicit Invalidator(RowCache* row_cache) : row_cache_(row_cache) {}
+
+    Status PutCF(uint32_t cf_id, const Slice& key, const Slice&) override {
+      row_cache_->Invalidate(cf_id, key);
+      return Status::OK();
+    }
+
+    Status DeleteCF(uint32_t cf_id, const Slice& key) override {
+      row_cache_->Invalidate(cf_id, key);
+      return Status::OK();
+    }
+
+    Status SingleDeleteCF(uint32_t cf_id, const Slice& key) override {
+      row_cache_->Invalidate(cf_id, key);
+      return Status::OK();
+    }
+
+    Status DeleteRangeCF(uint32_t, const Slice&, const Slice&) override {
+      row_cache_->InvalidateAll();
+      return Status::OK();
+    }
+
+    Status MergeCF(uint32_t cf_id, const Slice& key, const Slice&) override {
+      row_cache_->Invalidate(cf_id, key);
+      return Status::OK();
+    }
+
+    Status PutBlobIndexCF(uint32_t cf_id, const Slice& key,
+                          const Slice&) override {
+      row_cache_->Invalidate(cf_id, key);
+      return Status::OK();
+    }
+
+   private:
+    RowCache* row_cache_;
+  };
+
+  Invalidator invalidator(row_cache_.get());
+  Status s = updates->Iterate(&invalidator);
+  if (!s.ok()) {
+    // Can't tell which keys were written.
+    row_cache_->InvalidateAll();
+  }
 }
 
 Status TitanDBImpl::Delete(const rocksdb::WriteOptions& options,
                            rocksdb::ColumnFamilyHandle* column_family,
                            const rocksdb::Slice& key) {
-  return HasBGError() ? GetBGError() : db_->Delete(options, column_family, key);
+  if (HasBGError()) return GetBGError();
+  Status s = db_->Delete(options, column_family, key);
+  if (row_cache_) {
+    row_cache_->Invalidate(column_family->GetID(), key);
+  }
+  return s;
+}
+
+Status TitanDBImpl::DeleteRange(const rocksdb::WriteOptions& options,
+                                rocksdb::ColumnFamilyHandle* column_family,
+                                const rocksdb::Slice& begin_key,
+                                const rocksdb::Slice& end_key) {
+  if (HasBGError()) return GetBGError();
+  Status s = db_->DeleteRange(options, column_family, begin_key, end_key);
+  if (row_cache_) {
+    row_cache_->InvalidateAll();
+  }
+  return s;
 }
 
 Status TitanDBImpl::IngestExternalFile(
     rocksdb::ColumnFamilyHandle* column_family,
     const std::vector<std::string>& external_files,
     const rocksdb::IngestExternalFileOptions& options) {
-  return HasBGError()
-             ? GetBGError()
-             : db_->IngestExternalFile(column_family, external_files, options);
+  if (HasBGError()) return GetBGError();
+  Status s = db_->IngestExternalFile(column_family, external_files, options);
+  if (row_cache_) {
+    row_cache_->InvalidateAll();
+  }
+  return s;
 }
 
 Status TitanDBImpl::CompactRange(const rocksdb::CompactRangeOptions& options,
@@ -621,25 +849,56 @@ Status TitanDBImpl::Flush(const rocksdb::FlushOptions& options,
   return HasBGError() ? GetBGError() : db_->Flush(options, column_family);
 }
 
-Status TitanDBImpl::Get(const ReadOptions& options, ColumnFamilyHandle* handle,
-                        const Slice& key, PinnableSlice* value) {
+Status TitanDBImpl::Get(const TitanReadOptions& options,
+                        ColumnFamilyHandle* handle, const Slice& key,
+                        PinnableSlice* value) {
   if (options.snapshot) {
     return GetImpl(options, handle, key, value);
   }
-  ReadOptions ro(options);
-  ManagedSnapshot snapshot(this);
-  ro.snapshot = snapshot.snapshot();
-  return GetImpl(ro, handle, key, value);
+  uint32_t cf_id = handle->GetID();
+  uint64_t row_version = 0;
+  if (row_cache_) {
+    if (row_cache_->Lookup(cf_id, key, value)) {
+      if (stats_) stats_->recordTick(TitanStats::TITAN_ROW_CACHE_HIT, 1);
+      return Status::OK();
+    }
+    if (stats_) stats_->recordTick(TitanStats::TITAN_ROW_CACHE_MISS, 1);
+    // Taken before the read, so that a write racing with it leaves the
+    // entry stale.
+    row_version = row_cache_->Version(cf_id, key);
+  }
+  // Reads the latest sequence without registering a snapshot. Instead the
+  // guard keeps blob files made obsolete during the read from being purged,
+  // see BlobStorage::GetObsoleteFiles.
+  EpochGuard guard;
+  Status s = GetImpl(options, handle, key, value);
+  if (s.ok() && row_cache_ && options.fill_cache) {
+    row_cache_->Insert(cf_id, key, row_version, *value);
+  }
+  return s;
 }
 
-Status TitanDBImpl::GetImpl(const ReadOptions& options,
+Status TitanDBImpl::GetImpl(const TitanReadOptions& options,
                             ColumnFamilyHandle* handle, const Slice& key,
                             PinnableSlice* value) {
-  Status s;
+  Status s = CheckReadDeadline(env_, options);
+  if (!s.ok()) return s;
   bool is_blob_index = false;
   s = db_impl_->GetImpl(options, handle, key, value, nullptr /*value_found*/,
                         nullptr /*read_callback*/, &is_blob_index);
-  if (!s.ok() || !is_blob_index) return s;
+  if (!s.ok()) return s;
+  if (!is_blob_index) {
+    if (!track_hot_values_.load(std::memory_order_relaxed)) return s;
+    // Reads of inlined hot values keep them hot.
+    EpochGuard guard;
+    BlobStorage* storage =
+        blob_file_set_->GetBlobStorageUnlocked(handle->GetID());
+    if (storage) {
+      storage->RecordRead(key, value->size());
+    }
+    return s;
+  }
+  TEST_SYNC_POINT("TitanDBImpl::GetImpl:AfterBaseDBGet");
 
   StopWatch get_sw(env_, stats_.get(), BLOB_DB_GET_MICROS);
   // RecordTick(stats_.get(), BLOB_DB_NUM_GET);
@@ -648,13 +907,16 @@ Status TitanDBImpl::GetImpl(const ReadOptions& options,
   s = index.DecodeFrom(value);
   assert(s.ok());
   if (!s.ok()) return s;
+  s = CheckReadDeadline(env_, options);
+  if (!s.ok()) return s;
 
   BlobRecord record;
   PinnableSlice buffer;
 
-  mutex_.Lock();
-  auto storage = blob_file_set_->GetBlobStorage(handle->GetID()).lock();
-  mutex_.Unlock();
+  // Resolves the storage without mutex_, the guard keeps it alive.
+  EpochGuard guard;
+  BlobStorage* storage =
+      blob_file_set_->GetBlobStorageUnlocked(handle->GetID());
 
   if (storage) {
     StopWatch read_sw(env_, stats_.get(), BLOB_DB_BLOB_FILE_READ_MICROS);
@@ -672,45 +934,332 @@ Status TitanDBImpl::GetImpl(const ReadOptions& options,
     ROCKS_LOG_ERROR(db_options_.info_log,
                     "Key:%s Snapshot:%" PRIu64 " GetBlobFile err:%s\n",
                     key.ToString(true).c_str(),
-                    options.snapshot->GetSequenceNumber(),
+                    options.snapshot ? options.snapshot->GetSequenceNumber()
+                                     : kMaxSequenceNumber,
                     s.ToString().c_str());
   }
   if (s.ok()) {
+    storage->RecordRead(key, record.value.size());
+    // Hands the pinned blob over without copying it.
     value->Reset();
-    value->PinSelf(record.value);
+    value->PinSlice(record.value, &buffer);
+  }
+  return s;
+}
+
+Status TitanDBImpl::GetPartial(const TitanReadOptions& options,
+                               ColumnFamilyHandle* handle, const Slice& key,
+                               uint64_t offset, uint64_t len,
+                               PinnableSlice* value) {
+  Status s = CheckReadDeadline(env_, options);
+  if (!s.ok()) return s;
+  // Same as Get, the guard replaces a snapshot and keeps the storage alive.
+  EpochGuard guard;
+  PinnableSlice base_value;
+  bool is_blob_index = false;
+  s = db_impl_->GetImpl(options, handle, key, &base_value,
+                        nullptr /*value_found*/, nullptr /*read_callback*/,
+                        &is_blob_index);
+  if (!s.ok()) return s;
+  if (!is_blob_index) {
+    PinPartialValue(base_value, offset, len, &base_value, value);
+    return s;
+  }
+
+  StopWatch get_sw(env_, stats_.get(), BLOB_DB_GET_MICROS);
+  BlobIndex index;
+  s = index.DecodeFrom(&base_value);
+  assert(s.ok());
+  if (!s.ok()) return s;
+  s = CheckReadDeadline(env_, options);
+  if (!s.ok()) return s;
+
+  BlobStorage* storage =
+      blob_file_set_->GetBlobStorageUnlocked(handle->GetID());
+  if (!storage) {
+    return Status::NotFound(
+        "Column family id: " + std::to_string(handle->GetID()) + " not Found.");
+  }
+  StopWatch read_sw(env_, stats_.get(), BLOB_DB_BLOB_FILE_READ_MICROS);
+  s = storage->GetPartial(options, index, offset, len, value);
+  if (s.IsCorruption()) {
+    ROCKS_LOG_ERROR(db_options_.info_log,
+                    "Key:%s GetPartial blob err:%s\n",
+                    key.ToString(true).c_str(), s.ToString().c_str());
+  }
+  return s;
+}
+
+Status TitanDBImpl::GetStream(const TitanReadOptions& options,
+                              ColumnFamilyHandle* handle, const Slice& key,
+                              std::unique_ptr<SequentialFile>* result) {
+  Status s = CheckReadDeadline(env_, options);
+  if (!s.ok()) return s;
+  // Keeps the chunks from being purged while the stream is read.
+  TitanReadOptions ro(options);
+  std::shared_ptr<ManagedSnapshot> snapshot;
+  if (!ro.snapshot) {
+    snapshot.reset(new ManagedSnapshot(this));
+    ro.snapshot = snapshot->snapshot();
+  }
+  std::unique_ptr<PinnableSlice> value(new PinnableSlice());
+  bool is_blob_index = false;
+  s = db_impl_->GetImpl(ro, handle, key, value.get(), nullptr /*value_found*/,
+                        nullptr /*read_callback*/, &is_blob_index);
+  if (!s.ok()) return s;
+  if (!is_blob_index) {
+    result->reset(new BlobValueStream(std::move(value)));
+    return s;
+  }
+
+  BlobIndex index;
+  s = DecodeInto(*value, &index);
+  if (!s.ok()) return s;
+  std::shared_ptr<BlobStorage> storage;
+  {
+    MutexLock l(&mutex_);
+    storage = blob_file_set_->GetBlobStorage(handle->GetID()).lock();
+  }
+  if (!storage) {
+    return Status::NotFound(
+        "Column family id: " + std::to_string(handle->GetID()) + " not Found.");
+  }
+  if (!index.chunked) {
+    BlobRecord record;
+    PinnableSlice buffer;
+    s = storage->Get(ro, index, &record, &buffer);
+    if (!s.ok()) return s;
+    value->Reset();
+    value->PinSlice(record.value, &buffer);
+    result->reset(new BlobValueStream(std::move(value)));
+    return s;
+  }
+  std::unique_ptr<BlobChunkReader> reader;
+  s = storage->NewChunkReader(ro, index, &reader);
+  if (!s.ok()) return s;
+  result->reset(new BlobValueStream(std::move(reader), snapshot));
+  return s;
+}
+
+Status TitanDBImpl::GetValueSize(const TitanReadOptions& options,
+                                 ColumnFamilyHandle* handle, const Slice& key,
+                                 uint64_t* size) {
+  PinnableSlice value;
+  bool is_blob_index = false;
+  Status s = db_impl_->GetImpl(options, handle, key, &value,
+                               nullptr /*value_found*/,
+                               nullptr /*read_callback*/, &is_blob_index);
+  if (!s.ok()) return s;
+  if (!is_blob_index) {
+    *size = value.size();
+    return s;
   }
+  BlobIndex index;
+  s = index.DecodeFrom(&value);
+  if (!s.ok()) return s;
+  *size = index.EstimatedValueSize();
   return s;
 }
 
+bool TitanDBImpl::KeyMayExist(const ReadOptions& options,
+                              ColumnFamilyHandle* handle, const Slice& key,
+                              std::string* value, bool* value_found) {
+  if (value_found != nullptr) {
+    // falsify later if key-may-exist but can't fetch value
+    *value_found = true;
+  }
+  ReadOptions ro(options);
+  ro.read_tier = kBlockCacheTier;  // read from block cache only
+  PinnableSlice pinnable_val;
+  bool is_blob_index = false;
+  // Taken before the read, so that the blob file the index points to
+  // isn't purged before its value is looked up, see Get().
+  EpochGuard guard;
+  Status s = db_impl_->GetImpl(ro, handle, key, &pinnable_val, value_found,
+                               nullptr /*read_callback*/, &is_blob_index);
+  if (s.ok() && is_blob_index) {
+    // The key exists. Its value is only taken from the blob cache, blob
+    // files are not read.
+    BlobIndex index;
+    BlobRecord record;
+    PinnableSlice buffer;
+    Status blob_s = index.DecodeFrom(&pinnable_val);
+    BlobStorage* storage =
+        blob_file_set_->GetBlobStorageUnlocked(handle->GetID());
+    if (blob_s.ok() && storage != nullptr) {
+      blob_s = storage->Get(ro, index, &record, &buffer);
+    }
+    if (!blob_s.ok()) {
+      if (value_found != nullptr) {
+        *value_found = false;
+      }
+    } else if (value != nullptr) {
+      value->assign(record.value.data(), record.value.size());
+    }
+    return true;
+  }
+  if (s.ok() && value != nullptr) {
+    value->assign(pinnable_val.data(), pinnable_val.size());
+  }
+  // If block_cache is enabled and the index block of the table didn't
+  // not present in block_cache, the return value will be Status::Incomplete.
+  // In this case, key may still exist in the table.
+  return s.ok() || s.IsIncomplete();
+}
+
 std::vector<Status> TitanDBImpl::MultiGet(
     const ReadOptions& options, const std::vector<ColumnFamilyHandle*>& handles,
     const std::vector<Slice>& keys, std::vector<std::string>* values) {
   auto options_copy = options;
   options_copy.total_order_seek = true;
+  const size_t num_keys = keys.size();
+  std::vector<Status> res(num_keys);
+  values->resize(num_keys);
+  // PinnableSlice is not movable, so keep them in a fixed array.
+  std::unique_ptr<PinnableSlice[]> pinned(new PinnableSlice[num_keys]);
   if (options_copy.snapshot) {
-    return MultiGetImpl(options_copy, handles, keys, values);
+    MultiGetImpl(options_copy, num_keys, handles.data(), keys.data(),
+                 pinned.get(), res.data());
+  } else {
+    ReadOptions ro(options_copy);
+    ManagedSnapshot snapshot(this);
+    ro.snapshot = snapshot.snapshot();
+    MultiGetImpl(ro, num_keys, handles.data(), keys.data(), pinned.get(),
+                 res.data());
+  }
+  for (size_t i = 0; i < num_keys; i++) {
+    if (res[i].ok()) {
+      (*values)[i].assign(pinned[i].data(), pinned[i].size());
+    }
+  }
+  return res;
+}
+
+void TitanDBImpl::MultiGet(const ReadOptions& options,
+                           ColumnFamilyHandle* column_family,
+                           const size_t num_keys, const Slice* keys,
+                           PinnableSlice* values, Status* statuses,
+                           const bool /*sorted_input*/) {
+  auto options_copy = options;
+  options_copy.total_order_seek = true;
+  std::vector<ColumnFamilyHandle*> handles(num_keys, column_family);
+  if (options_copy.snapshot) {
+    MultiGetImpl(options_copy, num_keys, handles.data(), keys, values,
+                 statuses);
+    return;
   }
   ReadOptions ro(options_copy);
   ManagedSnapshot snapshot(this);
   ro.snapshot = snapshot.snapshot();
-  return MultiGetImpl(ro, handles, keys, values);
+  MultiGetImpl(ro, num_keys, handles.data(), keys, values, statuses);
 }
 
-std::vector<Status> TitanDBImpl::MultiGetImpl(
-    const ReadOptions& options, const std::vector<ColumnFamilyHandle*>& handles,
-    const std::vector<Slice>& keys, std::vector<std::string>* values) {
-  std::vector<Status> res;
-  res.resize(keys.size());
-  values->resize(keys.size());
-  for (size_t i = 0; i < keys.size(); i++) {
-    auto value = &(*values)[i];
-    PinnableSlice pinnable_value(value);
-    res[i] = GetImpl(options, handles[i], keys[i], &pinnable_value);
-    if (res[i].ok() && pinnable_value.IsPinned()) {
-      value->assign(pinnable_value.data(), pinnable_value.size());
+void TitanDBImpl::MultiGetImpl(const ReadOptions& options, size_t num_keys,
+                               ColumnFamilyHandle* const* handles,
+                               const Slice* keys, PinnableSlice* values,
+                               Status* statuses) {
+  // Blob records stay pinned in these buffers until they are handed over
+  // to "values".
+  std::unique_ptr<PinnableSlice[]> buffers(new PinnableSlice[num_keys]);
+  std::unique_ptr<BlobRecord[]> records(new BlobRecord[num_keys]);
+  std::vector<BlobGetRequest> requests(num_keys);
+
+  // Looks up all keys in LSM first and groups the blob indexes by the column
+  // family and blob file they point to.
+  std::map<std::pair<uint32_t, uint64_t>, std::vector<BlobGetRequest*>>
+      batches;
+  for (size_t i = 0; i < num_keys; i++) {
+    bool is_blob_index = false;
+    values[i].Reset();
+    statuses[i] = db_impl_->GetImpl(options, handles[i], keys[i], &values[i],
+                                    nullptr /*value_found*/,
+                                    nullptr /*read_callback*/, &is_blob_index);
+    if (!statuses[i].ok() || !is_blob_index) continue;
+
+    BlobIndex index;
+    Slice index_entry = values[i];
+    statuses[i] = index.DecodeFrom(&index_entry);
+    assert(statuses[i].ok());
+    if (!statuses[i].ok()) continue;
+    requests[i].handle = index.blob_handle;
+    requests[i].record = &records[i];
+    requests[i].buffer = &buffers[i];
+    if (index.chunked) {
+      // Chunked values are not batched, their chunks are read one by one.
+      EpochGuard guard;
+      BlobStorage* storage =
+          blob_file_set_->GetBlobStorageUnlocked(handles[i]->GetID());
+      requests[i].status =
+          storage ? storage->Get(options, index, &records[i], &buffers[i])
+                  : Status::NotFound("Column family id: " +
+                                     std::to_string(handles[i]->GetID()) +
+                                     " not Found.");
+      continue;
+    }
+    batches[std::make_pair(handles[i]->GetID(), index.file_number)].push_back(
+        &requests[i]);
+  }
+
+  if (!batches.empty()) {
+    StopWatch mget_sw(env_, stats_.get(), BLOB_DB_MULTIGET_MICROS);
+    std::unordered_map<uint32_t, std::shared_ptr<BlobStorage>> storages;
+    {
+      MutexLock l(&mutex_);
+      for (auto& batch : batches) {
+        uint32_t cf_id = batch.first.first;
+        if (storages.count(cf_id) == 0) {
+          storages[cf_id] = blob_file_set_->GetBlobStorage(cf_id).lock();
+        }
+      }
+    }
+
+    auto fetch = [&](const std::pair<uint32_t, uint64_t>& target,
+                     const std::vector<BlobGetRequest*>& batch) {
+      // Read concurrently, hence find() rather than operator[].
+      auto it = storages.find(target.first);
+      if (it == storages.end() || !it->second) {
+        for (auto* request : batch) {
+          request->status = Status::NotFound(
+              "Column family id: " + std::to_string(target.first) +
+              " not Found.");
+        }
+        return;
+      }
+      StopWatch read_sw(env_, stats_.get(), BLOB_DB_BLOB_FILE_READ_MICROS);
+      it->second->MultiGet(options, target.second, batch);
+    };
+    if (read_pool_ && batches.size() > 1) {
+      std::vector<std::future<void>> pending;
+      pending.reserve(batches.size());
+      for (auto& batch : batches) {
+        pending.emplace_back(read_pool_->addTask(
+            [&fetch, &batch]() { fetch(batch.first, batch.second); }));
+      }
+      for (auto& f : pending) {
+        f.wait();
+      }
+    } else {
+      for (auto& batch : batches) {
+        fetch(batch.first, batch.second);
+      }
+    }
+  }
+
+  for (size_t i = 0; i < num_keys; i++) {
+    if (!statuses[i].ok() || requests[i].record == nullptr) continue;
+    statuses[i] = requests[i].status;
+    values[i].Reset();
+    if (statuses[i].ok()) {
+      // Hands the pinned blob over without copying it.
+      values[i].PinSlice(records[i].value, &buffers[i]);
+    } else if (statuses[i].IsCorruption()) {
+      ROCKS_LOG_ERROR(db_options_.info_log,
+                      "Key:%s Snapshot:%" PRIu64 " GetBlobFile err:%s\n",
+                      keys[i].ToString(true).c_str(),
+                      options.snapshot->GetSequenceNumber(),
+                      statuses[i].ToString().c_str());
     }
   }
-  return res;
 }
 
 Iterator* TitanDBImpl::NewIterator(const TitanReadOptions& options,
@@ -745,8 +1294,18 @@ Iterator* TitanDBImpl::NewIteratorImpl(
   std::unique_ptr<ArenaWrappedDBIter> iter(db_impl_->NewIteratorImpl(
       options, cfd, options.snapshot->GetSequenceNumber(),
       nullptr /*read_callback*/, true /*allow_blob*/, true /*allow_refresh*/));
+  std::unique_ptr<ArenaWrappedDBIter> lookahead;
+  if (options.iterator_lookahead > 0 && !options.key_only &&
+      !options.value_size_only) {
+    // Finds the blobs to read ahead, over the same snapshot.
+    lookahead.reset(db_impl_->NewIteratorImpl(
+        options, cfd, options.snapshot->GetSequenceNumber(),
+        nullptr /*read_callback*/, true /*allow_blob*/,
+        true /*allow_refresh*/));
+  }
   return new TitanDBIterator(options, storage.get(), snapshot, std::move(iter),
-                             env_, stats_.get(), db_options_.info_log.get());
+                             env_, stats_.get(), db_options_.info_log.get(),
+                             read_pool_.get(), std::move(lookahead));
 }
 
 Status TitanDBImpl::NewIterators(
@@ -888,6 +1447,10 @@ Status TitanDBImpl::DeleteFilesInRanges(ColumnFamilyHandle* column_family,
   // property field to TableFileDeletionInfo.
   Status s =
       db_impl_->DeleteFilesInRanges(column_family, ranges, n, include_end);
+  if (row_cache_) {
+    // Keys in the dropped files are gone.
+    row_cache_->InvalidateAll();
+  }
   if (!s.ok()) return s;
 
   MutexLock l(&mutex_);
@@ -1,13 +1,18 @@
 #pragma once
 
+#include <functional>
+
 #include "db/db_impl/db_impl.h"
 #include "rocksdb/statistics.h"
 #include "util/repeatable_thread.h"
 
+#include "blob_chunk.h"
 #include "blob_file_manager.h"
 #include "blob_file_set.h"
+#include "row_cache.h"
 #include "table_builder.h"
 #include "table_factory.h"
+#include "threadpool.h"
 #include "titan/db.h"
 #include "titan_stats.h"
 
@@ -54,8 +59,9 @@ class TitanDBImpl : public TitanDB {
 
   Status CloseImpl();
 
-  int Scan(const ReadOptions& options, const std::string& start_key, int len,
-           std::vector<std::string>& keys,
+  using TitanDB::Scan;
+  int Scan(const TitanReadOptions& options, const std::string& start_key,
+           int len, std::vector<std::string>& keys,
            std::vector<std::string>& vals) override;
 
   using TitanDB::Put;
@@ -69,6 +75,11 @@ class TitanDBImpl : public TitanDB {
   Status Delete(const WriteOptions& options, ColumnFamilyHandle* column_family,
                 const Slice& key) override;
 
+  using TitanDB::DeleteRange;
+  Status DeleteRange(const WriteOptions& options,
+                     ColumnFamilyHandle* column_family, const Slice& begin_key,
+                     const Slice& end_key) override;
+
   using TitanDB::IngestExternalFile;
   Status IngestExternalFile(ColumnFamilyHandle* column_family,
                             const std::vector<std::string>& external_files,
@@ -84,15 +95,46 @@ class TitanDBImpl : public TitanDB {
                ColumnFamilyHandle* column_family) override;
 
   using TitanDB::Get;
-  Status Get(const ReadOptions& options, ColumnFamilyHandle* handle,
+  Status Get(const TitanReadOptions& options, ColumnFamilyHandle* handle,
              const Slice& key, PinnableSlice* value) override;
 
+  using TitanDB::GetPartial;
+  Status GetPartial(const TitanReadOptions& options,
+                    ColumnFamilyHandle* handle, const Slice& key,
+                    uint64_t offset, uint64_t len,
+                    PinnableSlice* value) override;
+
+  using TitanDB::PutStream;
+  Status PutStream(const WriteOptions& options,
+                   ColumnFamilyHandle* column_family, const Slice& key,
+                   SequentialFile* source) override;
+
+  using TitanDB::GetStream;
+  Status GetStream(const TitanReadOptions& options,
+                   ColumnFamilyHandle* handle, const Slice& key,
+                   std::unique_ptr<SequentialFile>* result) override;
+
+  using TitanDB::GetValueSize;
+  Status GetValueSize(const TitanReadOptions& options,
+                      ColumnFamilyHandle* handle, const Slice& key,
+                      uint64_t* size) override;
+
+  using TitanDB::KeyMayExist;
+  bool KeyMayExist(const ReadOptions& options, ColumnFamilyHandle* handle,
+                   const Slice& key, std::string* value,
+                   bool* value_found = nullptr) override;
+
   using TitanDB::MultiGet;
   std::vector<Status> MultiGet(const ReadOptions& options,
                                const std::vector<ColumnFamilyHandle*>& handles,
                                const std::vector<Slice>& keys,
                                std::vector<std::string>* values) override;
 
+  void MultiGet(const ReadOptions& options, ColumnFamilyHandle* column_family,
+                const size_t num_keys, const Slice* keys,
+                PinnableSlice* values, Status* statuses,
+                const bool sorted_input = false) override;
+
   using TitanDB::NewIterator;
   Iterator* NewIterator(const TitanReadOptions& options,
                         ColumnFamilyHandle* handle) override;
@@ -161,13 +203,22 @@ class TitanDBImpl : public TitanDB {
       const TitanDBOptions& options,
       const std::vector<TitanCFDescriptor>& column_families) const;
 
-  Status GetImpl(const ReadOptions& options, ColumnFamilyHandle* handle,
+  Status GetImpl(const TitanReadOptions& options, ColumnFamilyHandle* handle,
                  const Slice& key, PinnableSlice* value);
 
-  std::vector<Status> MultiGetImpl(
-      const ReadOptions& options,
-      const std::vector<ColumnFamilyHandle*>& handles,
-      const std::vector<Slice>& keys, std::vector<std::string>* values);
+  // Writes the value of "key" in chunks into a blob file of its own, see
+  // PutStream. "fill" appends the value to the writer.
+  Status WriteChunkedValue(
+      const WriteOptions& options, ColumnFamilyHandle* column_family,
+      const Slice& key, const std::function<Status(BlobChunkWriter*)>& fill);
+
+  // Invalidates the row cache entries of the keys written by "updates".
+  void InvalidateRowCache(WriteBatch* updates);
+
+  // Values are pinned in "values", blob values included.
+  void MultiGetImpl(const ReadOptions& options, size_t num_keys,
+                    ColumnFamilyHandle* const* handles, const Slice* keys,
+                    PinnableSlice* values, Status* statuses);
 
   Iterator* NewIteratorImpl(const TitanReadOptions& options,
                             ColumnFamilyHandle* handle,
@@ -231,6 +282,9 @@ class TitanDBImpl : public TitanDB {
 
   void DumpStats();
 
+  // Dumps the hot blobs of the blob caches, logging failures.
+  void DumpHotBlobs();
+
   FileLock* lock_{nullptr};
   // The lock sequence must be Titan.mutex_.Lock() -> Base DB mutex_.Lock()
   // while the unlock sequence must be Base DB mutex.Unlock() ->
@@ -257,6 +311,9 @@ class TitanDBImpl : public TitanDB {
   // is not null.
   std::unique_ptr<TitanStats> stats_;
 
+  // Null if titan_row_cache is not set.
+  std::unique_ptr<RowCache> row_cache_;
+
   // Access while holding mutex_ lock or during DB open.
   std::unordered_map<uint32_t, TitanColumnFamilyInfo> cf_info_;
 
@@ -268,10 +325,20 @@ class TitanDBImpl : public TitanDB {
   // handle for dump internal stats at fixed intervals.
   std::unique_ptr<RepeatableThread> thread_dump_stats_;
 
+  // handle for dump hot blobs at fixed intervals.
+  std::unique_ptr<RepeatableThread> thread_dump_hot_blobs_;
+
+  // Loads the hot blobs dumped before the last close into the blob caches.
+  port::Thread warmup_thread_;
+
   std::unique_ptr<BlobFileSet> blob_file_set_;
   std::set<uint64_t> pending_outputs_;
   std::shared_ptr<BlobFileManager> blob_manager_;
 
+  // Reads blob files in parallel for foreground requests. Null if
+  // num_blob_read_threads is zero.
+  std::unique_ptr<ThreadPool> read_pool_;
+
   // gc_queue_ hold column families that we need to gc.
   // pending_gc_ hold column families that already on gc_queue_.
   std::deque<uint32_t> gc_queue_;
@@ -286,6 +353,9 @@ class TitanDBImpl : public TitanDB {
   int drop_cf_requests_ = 0;
 
   std::atomic_bool shuting_down_{false};
+  // Set once any column family tracks hot values, so that reads of inline
+  // values skip the tracking otherwise.
+  std::atomic<bool> track_hot_values_{false};
   std::atomic<bool> block_for_size_{false};
   port::CondVar size_cv_;
   mutable port::Mutex size_mutex_;
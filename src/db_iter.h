@@ -6,6 +6,10 @@
 
 #include <inttypes.h>
 
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <map>
 #include <memory>
 #include <unordered_map>
 
@@ -16,24 +20,37 @@
 #include "vector"
 
 #include "threadpool.h"
+#include "titan/db.h"
 #include "titan_stats.h"
 
 namespace rocksdb {
 namespace titandb {
 
-class TitanDBIterator : public Iterator {
+class TitanDBIterator : public TitanIterator {
  public:
   TitanDBIterator(const TitanReadOptions& options, BlobStorage* storage,
                   std::shared_ptr<ManagedSnapshot> snap,
                   std::unique_ptr<ArenaWrappedDBIter> iter, Env* env,
-                  TitanStats* stats, Logger* info_log)
+                  TitanStats* stats, Logger* info_log,
+                  ThreadPool* read_pool = nullptr,
+                  std::unique_ptr<ArenaWrappedDBIter> lookahead = nullptr)
       : options_(options),
         storage_(storage),
         snap_(snap),
         iter_(std::move(iter)),
         env_(env),
         stats_(stats),
-        info_log_(info_log) {}
+        info_log_(info_log),
+        read_pool_(read_pool),
+        lookahead_(std::move(lookahead)) {
+    ResetLookahead();
+  }
+
+  ~TitanDBIterator() {
+    // Reads in flight use this iterator.
+    RetireRead(&pending_value_);
+    ResetLookahead();
+  }
 
   bool Valid() const override { return iter_->Valid(); /*&& status_.ok(); */ }
 
@@ -48,74 +65,69 @@ class TitanDBIterator : public Iterator {
 
   void SeekToFirst() override {
     iter_->SeekToFirst();
-    if (ShouldGetBlobValue()) {
-      StopWatch seek_sw(env_, stats_, BLOB_DB_SEEK_MICROS);
-      GetBlobValue();
-      // RecordTick(stats_, BLOB_DB_NUM_SEEK);
-    }
+    RestartLookahead();
+    PositionChanged(BLOB_DB_SEEK_MICROS);
   }
 
   void SeekToLast() override {
+    ResetLookahead();
     iter_->SeekToLast();
-    if (ShouldGetBlobValue()) {
-      StopWatch seek_sw(env_, stats_, BLOB_DB_SEEK_MICROS);
-      GetBlobValue();
-      // RecordTick(stats_, BLOB_DB_NUM_SEEK);
-    }
+    PositionChanged(BLOB_DB_SEEK_MICROS);
   }
 
   void Seek(const Slice& target) override {
     iter_->Seek(target);
-    if (ShouldGetBlobValue()) {
-      StopWatch seek_sw(env_, stats_, BLOB_DB_SEEK_MICROS);
-      GetBlobValue();
-      // RecordTick(stats_, BLOB_DB_NUM_SEEK);
-    }
+    RestartLookahead();
+    PositionChanged(BLOB_DB_SEEK_MICROS);
   }
 
   void SeekForPrev(const Slice& target) override {
+    ResetLookahead();
     iter_->SeekForPrev(target);
-    if (ShouldGetBlobValue()) {
-      StopWatch seek_sw(env_, stats_, BLOB_DB_SEEK_MICROS);
-      GetBlobValue();
-      // RecordTick(stats_, BLOB_DB_NUM_SEEK);
-    }
+    PositionChanged(BLOB_DB_SEEK_MICROS);
   }
 
   void Next() override {
     assert(Valid());
     iter_->Next();
-    if (ShouldGetBlobValue()) {
-      StopWatch next_sw(env_, stats_, BLOB_DB_NEXT_MICROS);
-      GetBlobValue();
-      // RecordTick(stats_, BLOB_DB_NUM_NEXT);
-    }
+    LookaheadEntry ahead = PopLookahead();
+    // Keeps the window full before waiting for the value.
+    FillLookahead();
+    PositionChanged(BLOB_DB_NEXT_MICROS, &ahead);
   }
 
-void Scan(const Slice& target, int& len, std::vector<std::string>& keys,
+  void Scan(const Slice& target, int& len, std::vector<std::string>& keys,
             std::vector<std::string>& values) {
-    std::vector<BlobIndex> indexes(len);
+    // Blob values are collected per blob file and fetched as one batch per
+    // file, so that all reads of a file are in flight together. Files are
+    // fetched in parallel, see TitanReadOptions::scan_fan_out.
+    std::vector<BlobRecord> records(len);
+    std::unique_ptr<PinnableSlice[]> buffers(new PinnableSlice[len]);
+    std::vector<BlobGetRequest> requests(len);
+    std::map<uint64_t, std::vector<BlobGetRequest*>> batches;
     int i = 0;
+    ResetLookahead();
     iter_->Seek(target);
     while (i < len && Valid()) {
       if (ShouldGetBlobValue()) {
         assert(iter_->status().ok());
-        status_ = DecodeInto(iter_->value(), &indexes[i]);
+        BlobIndex index;
+        status_ = DecodeInto(iter_->value(), &index);
         if (!status_.ok()) {
           return;
         }
-        auto it = files_.find(indexes[i].file_number);
-        if (it == files_.end()) {
-          std::unique_ptr<BlobFilePrefetcher> prefetcher;
-          status_ =
-              storage_->NewPrefetcher(indexes[i].file_number, &prefetcher);
-          if (!status_.ok()) {
-            return;
-          }
-          it = files_.emplace(indexes[i].file_number, std::move(prefetcher))
-                   .first;
+        requests[i].handle = index.blob_handle;
+        requests[i].record = &records[i];
+        requests[i].buffer = &buffers[i];
+        if (index.chunked) {
+          // Read on their own, chunk by chunk.
+          requests[i].status =
+              storage_->Get(options_, index, &records[i], &buffers[i]);
+        } else {
+          batches[index.file_number].push_back(&requests[i]);
         }
-        it->second->Prefetch(indexes[i].blob_handle);
+      } else if (iter_->IsBlob() && options_.value_size_only) {
+        values[i].clear();
       } else {
         values[i] = iter_->value().ToString();
       }
@@ -124,71 +136,35 @@ void Scan(const Slice& target, int& len, std::vector<std::string>& keys,
       i++;
     }
     len = i;
-    BlobRecord record;
-    PinnableSlice buffer;
-    for (int j=0;j<len;j++){
-      if(values[j].empty()){
-        auto it = files_.find(indexes[j].file_number);
-        it->second->PointGet(options_, indexes[j].blob_handle, &record, &buffer);
-        values[j] = std::move(record.value.ToString());
+    if (!batches.empty()) {
+      status_ = CheckReadDeadline(env_, options_);
+      if (!status_.ok()) {
+        return;
       }
     }
-  }
-
-/*
-  void Scan(const Slice& target, int& len, std::vector<std::string>& keys,
-            std::vector<std::string>& values) {
-    std::vector<BlobIndex> indexes(len);
-    int i = 0;
-    iter_->Seek(target);
-    while (i < len && Valid()) {
-      if (ShouldGetBlobValue()) {
-        assert(iter_->status().ok());
-        status_ = DecodeInto(iter_->value(), &indexes[i]);
-        if (!status_.ok()) {
-          return;
-        }
-        auto it = files_.find(indexes[i].file_number);
-        if (it == files_.end()) {
-          std::unique_ptr<BlobFilePrefetcher> prefetcher;
-          status_ =
-              storage_->NewPrefetcher(indexes[i].file_number, &prefetcher);
-          if (!status_.ok()) {
-            return;
-          }
-          it = files_.emplace(indexes[i].file_number, std::move(prefetcher))
-                   .first;
-        }
-      } else {
-        values[i] = iter_->value().ToString();
+    FetchBatches(&batches);
+    for (int j = 0; j < len; j++) {
+      if (requests[j].record == nullptr) {
+        continue;
       }
-      keys[i] = iter_->key().ToString();
-      iter_->Next();
-      i++;
-    }
-    len = i;
-    int bulk = std::max(16, len / 8);
-    std::vector<std::future<Status>> ss;
-    for (int j = 0; j < len; j += bulk) {
-      ss.emplace_back(pool_->addTask(
-          &TitanDBIterator::BulkRead, this, std::ref(indexes), std::ref(keys),
-          std::ref(values), j, std::min(j + bulk, len)));
-    }
-    for (auto& fs : ss) {
-      auto s = fs.get();
+      if (!requests[j].status.ok()) {
+        status_ = requests[j].status;
+        ROCKS_LOG_ERROR(info_log_,
+                        "Titan iterator: failed to scan blob value at "
+                        "offset %" PRIu64 ": %s",
+                        requests[j].handle.offset,
+                        status_.ToString().c_str());
+        return;
+      }
+      values[j] = records[j].value.ToString();
     }
-    return;
   }
-  */
-  // */
+
   void Prev() override {
     assert(Valid());
+    ResetLookahead();
     iter_->Prev();
-    if (ShouldGetBlobValue()) {
-      StopWatch prev_sw(env_, stats_, BLOB_DB_PREV_MICROS);
-      GetBlobValue();
-      // RecordTick(stats_, BLOB_DB_NUM_PREV);
-    }
+    PositionChanged(BLOB_DB_PREV_MICROS);
   }
 
   Slice key() const override {
@@ -200,33 +176,312 @@ void Scan(const Slice& target, int& len, std::vector<std::string>& keys,
     assert(Valid() && !options_.key_only);
     if (options_.key_only) return Slice();
     if (!iter_->IsBlob()) return iter_->value();
+    if (options_.value_size_only) return Slice();
+    if (!value_loaded_) {
+      // Only fills in what the iterator caches of the current entry.
+      const_cast<TitanDBIterator*>(this)->LoadDeferredValue();
+    }
     return record_.value;
   }
 
+  bool IsValueLoaded() const override {
+    return value_loaded_ ||
+           (pending_value_.value &&
+            pending_value_.done.wait_for(std::chrono::seconds(0)) ==
+                std::future_status::ready);
+  }
+
+  void PrefetchValue() override {
+    if (value_loaded_ || pending_value_.value) {
+      return;
+    }
+    StartValueRead(iter_->value(), &pending_value_);
+  }
+
+  Status GetProperty(std::string prop_name, std::string* prop) override {
+    if (prop_name != TitanDB::Properties::kIteratorValueSize) {
+      return iter_->GetProperty(prop_name, prop);
+    }
+    if (!Valid()) {
+      return Status::InvalidArgument("Iterator is not valid.");
+    }
+    uint64_t size = 0;
+    if (!iter_->IsBlob()) {
+      size = iter_->value().size();
+    } else if (!options_.value_size_only && !options_.key_only &&
+               value_loaded_) {
+      size = record_.value.size();
+    } else {
+      BlobIndex index;
+      Status s = DecodeInto(iter_->value(), &index);
+      if (!s.ok()) {
+        return s;
+      }
+      size = index.EstimatedValueSize();
+    }
+    *prop = ToString(size);
+    return Status::OK();
+  }
+
  private:
-  Status BulkRead(const std::vector<BlobIndex>& indexes,
-                  std::vector<std::string>& keys,
-                  std::vector<std::string>& vals, int start, int end) {
-    PinnableSlice buffer;
+  // The value read ahead of an entry, filled in by a read thread.
+  struct PrefetchedValue {
     BlobRecord record;
-    Status s;
-    for (int j = start; j < end; j++) {
-      if (vals[j] == "") {
-        auto it = files_.find(indexes[j].file_number);
-        auto r =
-            it->second->Get(options_, indexes[j].blob_handle, &record, &buffer);
-        if (!r.ok()) {
-          s = r;
-        } else {
-          vals[j] = record.value.ToString();
-        }
+    PinnableSlice buffer;
+    Status status;
+  };
+
+  // An entry ahead of the iterator, see TitanReadOptions::iterator_lookahead.
+  struct LookaheadEntry {
+    std::string key;
+    // Set if its blob value is being read on a read thread.
+    std::shared_ptr<PrefetchedValue> value;
+    std::future<void> done;
+    // Whether it was read by "lookahead_" rather than by PrefetchValue(),
+    // only those adapt the window.
+    bool ahead{false};
+  };
+
+  // Called once "iter_" has moved. Reads the value of the new entry, or
+  // leaves it to value() with TitanReadOptions::lazy_value. "ahead", if
+  // any, is the entry looked ahead for it.
+  void PositionChanged(Histograms histogram,
+                       LookaheadEntry* ahead = nullptr) {
+    RetireRead(&pending_value_);
+    if (ahead != nullptr) {
+      pending_value_ = std::move(*ahead);
+    }
+    value_loaded_ = !ShouldGetBlobValue();
+    if (value_loaded_) {
+      RetireRead(&pending_value_);
+      return;
+    }
+    if (options_.lazy_value) {
+      status_ = iter_->status();
+      value_histogram_ = histogram;
+      return;
+    }
+    StopWatch sw(env_, stats_, histogram);
+    LoadValue();
+  }
+
+  void LoadDeferredValue() {
+    StopWatch sw(env_, stats_, value_histogram_);
+    LoadValue();
+  }
+
+  void LoadValue() {
+    if (pending_value_.value) {
+      TakeLookahead(&pending_value_);
+      pending_value_ = LookaheadEntry();
+    } else {
+      GetBlobValue();
+    }
+    if (!status_.ok()) {
+      // Nothing may point into the value of a previous entry, which is
+      // released by now.
+      record_ = BlobRecord();
+      buffer_.Reset();
+      prefetched_.reset();
+    }
+    value_loaded_ = true;
+  }
+
+  // Drops "entry", keeping its read around until it is done.
+  void RetireRead(LookaheadEntry* entry) {
+    retired_reads_.erase(
+        std::remove_if(retired_reads_.begin(), retired_reads_.end(),
+                       [](const LookaheadEntry& retired) {
+                         return retired.done.wait_for(std::chrono::seconds(
+                                    0)) == std::future_status::ready;
+                       }),
+        retired_reads_.end());
+    if (entry->done.valid()) {
+      retired_reads_.push_back(std::move(*entry));
+    }
+    *entry = LookaheadEntry();
+  }
+
+  // Drops the entries read ahead, waiting for their reads, and goes back
+  // to the smallest window.
+  void ResetLookahead() {
+    for (auto& entry : lookahead_entries_) {
+      if (entry.done.valid()) {
+        entry.done.wait();
+      }
+    }
+    for (auto& entry : retired_reads_) {
+      entry.done.wait();
+    }
+    retired_reads_.clear();
+    lookahead_entries_.clear();
+    lookahead_active_ = false;
+    lookahead_window_ = options_.iterator_lookahead < kInitialLookahead
+                            ? options_.iterator_lookahead
+                            : kInitialLookahead;
+    lookahead_ready_streak_ = 0;
+  }
+
+  // Starts reading ahead of the entry "iter_" has just been positioned at.
+  void RestartLookahead() {
+    ResetLookahead();
+    if (!lookahead_ || !iter_->Valid()) {
+      return;
+    }
+    lookahead_->Seek(iter_->key());
+    if (!lookahead_->Valid() || lookahead_->key() != iter_->key()) {
+      return;
+    }
+    lookahead_->Next();
+    lookahead_active_ = true;
+    FillLookahead();
+  }
+
+  // Walks "lookahead_" forward until the window is full, starting the
+  // reads of the blob values it passes. The upper bound of the read
+  // options applies to it as to "iter_".
+  void FillLookahead() {
+    if (!lookahead_active_) {
+      return;
+    }
+    while (lookahead_entries_.size() < lookahead_window_ &&
+           lookahead_->Valid()) {
+      LookaheadEntry entry;
+      entry.key = lookahead_->key().ToString();
+      entry.ahead = true;
+      if (lookahead_->IsBlob()) {
+        StartValueRead(lookahead_->value(), &entry);
       }
+      lookahead_entries_.push_back(std::move(entry));
+      lookahead_->Next();
+    }
+  }
+
+  // Starts reading the blob value "index_entry" points to on a read
+  // thread, or hints the OS to read it if there are none.
+  void StartValueRead(const Slice& index_entry, LookaheadEntry* entry) {
+    BlobIndex index;
+    if (!DecodeInto(index_entry, &index).ok() || index.chunked ||
+        !CheckReadDeadline(env_, options_).ok()) {
+      // Left to GetBlobValue.
+      return;
+    }
+    if (read_pool_ == nullptr) {
+      // Only hints the OS to read it.
+      BlobFilePrefetcher* prefetcher = nullptr;
+      if (GetPrefetcher(index.file_number, &prefetcher).ok()) {
+        prefetcher->Prefetch(index.blob_handle);
+      }
+      return;
+    }
+    std::shared_ptr<PrefetchedValue> value(new PrefetchedValue);
+    entry->value = value;
+    entry->done = read_pool_->addTask([this, index, value]() {
+      value->status =
+          storage_->Get(options_, index, &value->record, &value->buffer);
+    });
+  }
+
+  // Pops the entry read ahead for the one "iter_" has just moved to, or
+  // returns an empty entry if there is none.
+  LookaheadEntry PopLookahead() {
+    LookaheadEntry entry;
+    if (!lookahead_active_ || lookahead_entries_.empty()) {
+      return entry;
+    }
+    if (!iter_->Valid() || lookahead_entries_.front().key != iter_->key()) {
+      // Out of step, e.g. the iterator failed.
+      ResetLookahead();
+      return entry;
+    }
+    entry = std::move(lookahead_entries_.front());
+    lookahead_entries_.pop_front();
+    return entry;
+  }
+
+  // Makes the value read ahead in "entry" the current one. If "lookahead_"
+  // read it, widens the window if it isn't there yet and narrows it if
+  // values keep being ready early.
+  void TakeLookahead(LookaheadEntry* entry) {
+    if (entry->done.wait_for(std::chrono::seconds(0)) !=
+        std::future_status::ready) {
+      if (entry->ahead) {
+        lookahead_window_ = std::min<size_t>(lookahead_window_ * 2,
+                                             options_.iterator_lookahead);
+        lookahead_ready_streak_ = 0;
+      }
+      entry->done.wait();
+    } else if (entry->ahead &&
+               ++lookahead_ready_streak_ >= 2 * lookahead_window_ &&
+               lookahead_window_ > 1) {
+      lookahead_window_--;
+      lookahead_ready_streak_ = 0;
+    }
+    buffer_.Reset();
+    prefetched_ = std::move(entry->value);
+    record_ = prefetched_->record;
+    status_ = prefetched_->status;
+    if (!status_.ok()) {
+      ROCKS_LOG_ERROR(info_log_,
+                      "Titan iterator: failed to read blob value ahead: %s",
+                      status_.ToString().c_str());
+    }
+  }
+
+  Status GetPrefetcher(uint64_t file_number, BlobFilePrefetcher** result) {
+    auto it = files_.find(file_number);
+    if (it == files_.end()) {
+      std::unique_ptr<BlobFilePrefetcher> prefetcher;
+      Status s = storage_->NewPrefetcher(file_number, &prefetcher);
+      if (!s.ok()) {
+        return s;
+      }
+      it = files_.emplace(file_number, std::move(prefetcher)).first;
+    }
+    *result = it->second.get();
+    return Status::OK();
+  }
+
+  // Fetches "batches", keyed by blob file, splitting the files among up
+  // to TitanReadOptions::scan_fan_out tasks.
+  void FetchBatches(
+      std::map<uint64_t, std::vector<BlobGetRequest*>>* batches) {
+    if (batches->empty()) {
+      return;
+    }
+    size_t fan_out = 1;
+    if (read_pool_ != nullptr) {
+      fan_out = options_.scan_fan_out > 0 ? options_.scan_fan_out
+                                          : read_pool_->threadCount() + 1;
+    }
+    fan_out = std::min(fan_out, batches->size());
+    std::vector<std::pair<const uint64_t, std::vector<BlobGetRequest*>>*>
+        files;
+    files.reserve(batches->size());
+    for (auto& batch : *batches) {
+      files.push_back(&batch);
+    }
+    auto fetch = [this, &files, fan_out](size_t task) {
+      for (size_t f = task; f < files.size(); f += fan_out) {
+        StopWatch read_sw(env_, stats_, BLOB_DB_BLOB_FILE_READ_MICROS);
+        storage_->MultiGet(options_, files[f]->first, files[f]->second,
+                           options_.scan_coalesce_gap);
+      }
+    };
+    std::vector<std::future<void>> pending;
+    for (size_t task = 1; task < fan_out; task++) {
+      pending.emplace_back(read_pool_->addTask(fetch, task));
+    }
+    // The calling thread takes a share rather than only waiting.
+    fetch(0);
+    for (auto& f : pending) {
+      f.wait();
     }
-    return s;
   }
 
   bool ShouldGetBlobValue() {
-    if (!iter_->Valid() || !iter_->IsBlob() || options_.key_only) {
+    if (!iter_->Valid() || !iter_->IsBlob() || options_.key_only ||
+        options_.value_size_only) {
       status_ = iter_->status();
       return false;
     }
@@ -235,6 +490,7 @@ void Scan(const Slice& target, int& len, std::vector<std::string>& keys,
 
   void GetBlobValue() {
     assert(iter_->status().ok());
+    prefetched_.reset();
 
     BlobIndex index;
     status_ = DecodeInto(iter_->value(), &index);
@@ -246,23 +502,40 @@ void Scan(const Slice& target, int& len, std::vector<std::string>& keys,
       return;
     }
 
-    auto it = files_.find(index.file_number);
-    if (it == files_.end()) {
-      std::unique_ptr<BlobFilePrefetcher> prefetcher;
-      status_ = storage_->NewPrefetcher(index.file_number, &prefetcher);
+    if (index.chunked) {
+      // Chunks are read through the blob file cache rather than a
+      // prefetcher.
+      buffer_.Reset();
+      status_ = CheckReadDeadline(env_, options_);
+      if (status_.ok()) {
+        status_ = storage_->Get(options_, index, &record_, &buffer_);
+      }
       if (!status_.ok()) {
-        ROCKS_LOG_ERROR(
-            info_log_,
-            "Titan iterator: failed to create prefetcher for blob file %" PRIu64
-            ": %s",
-            index.file_number, status_.ToString().c_str());
-        return;
+        ROCKS_LOG_ERROR(info_log_,
+                        "Titan iterator: failed to read chunked value from "
+                        "file %" PRIu64 ": %s",
+                        index.file_number, status_.ToString().c_str());
       }
-      it = files_.emplace(index.file_number, std::move(prefetcher)).first;
+      return;
+    }
+
+    BlobFilePrefetcher* prefetcher = nullptr;
+    status_ = GetPrefetcher(index.file_number, &prefetcher);
+    if (!status_.ok()) {
+      ROCKS_LOG_ERROR(
+          info_log_,
+          "Titan iterator: failed to create prefetcher for blob file %" PRIu64
+          ": %s",
+          index.file_number, status_.ToString().c_str());
+      return;
     }
 
     buffer_.Reset();
-    status_ = it->second->Get(options_, index.blob_handle, &record_, &buffer_);
+    status_ = CheckReadDeadline(env_, options_);
+    if (!status_.ok()) {
+      return;
+    }
+    status_ = prefetcher->Get(options_, index.blob_handle, &record_, &buffer_);
     if (!status_.ok()) {
       ROCKS_LOG_ERROR(
           info_log_,
@@ -274,9 +547,21 @@ void Scan(const Slice& target, int& len, std::vector<std::string>& keys,
     return;
   }
 
+  static const size_t kInitialLookahead = 2;
+
   Status status_;
   BlobRecord record_;
   PinnableSlice buffer_;
+  // Holds "record_" if it was read ahead.
+  std::shared_ptr<PrefetchedValue> prefetched_;
+  // False until the value of a blob entry is read, see
+  // TitanReadOptions::lazy_value.
+  bool value_loaded_{true};
+  Histograms value_histogram_{BLOB_DB_SEEK_MICROS};
+  // The read started for the current entry, if any.
+  LookaheadEntry pending_value_;
+  // Reads of entries passed by, waited for before the iterator goes away.
+  std::vector<LookaheadEntry> retired_reads_;
 
   TitanReadOptions options_;
   BlobStorage* storage_;
@@ -287,7 +572,15 @@ void Scan(const Slice& target, int& len, std::vector<std::string>& keys,
   Env* env_;
   TitanStats* stats_;
   Logger* info_log_;
-  static ThreadPool* pool_;
+  // Shared by the DB, may be null.
+  ThreadPool* read_pool_;
+
+  // Walks ahead of "iter_" over the same snapshot, may be null.
+  std::unique_ptr<ArenaWrappedDBIter> lookahead_;
+  bool lookahead_active_{false};
+  std::deque<LookaheadEntry> lookahead_entries_;
+  size_t lookahead_window_{0};
+  size_t lookahead_ready_streak_{0};
 };
 
 }  // namespace titandb
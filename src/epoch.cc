@@ -0,0 +1,115 @@
+#include "epoch.h"
+
+#include <assert.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace rocksdb {
+namespace titandb {
+
+// Slot ownership and guard nesting of a thread in the default domain.
+struct EpochDomain::ThreadState {
+  EpochDomain::Slot* slot{nullptr};
+  bool overflow{false};
+  int depth{0};
+
+  ~ThreadState() {
+    if (slot != nullptr) {
+      slot->in_use.store(false, std::memory_order_release);
+    }
+  }
+};
+
+EpochDomain* EpochDomain::Default() {
+  static EpochDomain* domain = new EpochDomain();
+  return domain;
+}
+
+EpochDomain::ThreadState* EpochDomain::GetThreadState() {
+  static thread_local ThreadState state;
+  if (state.slot == nullptr && !state.overflow) {
+    for (size_t i = 0; i < kMaxSlots; i++) {
+      bool expected = false;
+      if (!slots_[i].in_use.load(std::memory_order_relaxed) &&
+          slots_[i].in_use.compare_exchange_strong(expected, true)) {
+        state.slot = &slots_[i];
+        break;
+      }
+    }
+    state.overflow = state.slot == nullptr;
+  }
+  return &state;
+}
+
+void EpochDomain::Enter() {
+  ThreadState* state = GetThreadState();
+  if (state->depth++ > 0) {
+    return;
+  }
+  if (state->slot != nullptr) {
+    state->slot->epoch.store(global_epoch_.load(std::memory_order_relaxed),
+                             std::memory_order_relaxed);
+  } else {
+    overflow_readers_.fetch_add(1, std::memory_order_relaxed);
+  }
+  // The announcement must be visible before any protected pointer is read.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void EpochDomain::Exit() {
+  ThreadState* state = GetThreadState();
+  assert(state->depth > 0);
+  if (--state->depth > 0) {
+    return;
+  }
+  if (state->slot != nullptr) {
+    state->slot->epoch.store(0, std::memory_order_release);
+  } else {
+    overflow_readers_.fetch_sub(1, std::memory_order_release);
+  }
+}
+
+uint64_t EpochDomain::MinActiveEpoch() const {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  uint64_t min_epoch = global_epoch_.load(std::memory_order_acquire);
+  if (overflow_readers_.load(std::memory_order_acquire) > 0) {
+    return 0;
+  }
+  for (size_t i = 0; i < kMaxSlots; i++) {
+    uint64_t epoch = slots_[i].epoch.load(std::memory_order_acquire);
+    if (epoch != 0) {
+      min_epoch = std::min(min_epoch, epoch);
+    }
+  }
+  return min_epoch;
+}
+
+void EpochDomain::Retire(std::function<void()> deleter) {
+  {
+    std::lock_guard<std::mutex> l(retired_mutex_);
+    // Readers that entered at this epoch or before may still see the
+    // object, later ones cannot.
+    retired_.emplace_back(Advance(), std::move(deleter));
+  }
+  Reclaim();
+}
+
+void EpochDomain::Reclaim() {
+  uint64_t min_epoch = MinActiveEpoch();
+  std::vector<std::function<void()>> reclaimable;
+  {
+    std::lock_guard<std::mutex> l(retired_mutex_);
+    while (!retired_.empty() && retired_.front().first < min_epoch) {
+      reclaimable.push_back(std::move(retired_.front().second));
+      retired_.pop_front();
+    }
+  }
+  // Deleters may retire objects themselves, so run them unlocked.
+  for (auto& deleter : reclaimable) {
+    deleter();
+  }
+}
+
+}  // namespace titandb
+}  // namespace rocksdb
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+#include "port/port.h"
+
+namespace rocksdb {
+namespace titandb {
+
+// Epoch based reclamation for data structures read without locks.
+//
+// Readers bracket their accesses with an EpochGuard. Writers first
+// unpublish an object, e.g. by swapping an atomic pointer, and then hand
+// it to Retire(). The object is destroyed once every reader that entered
+// before the swap has left its guard, so readers never touch a refcount.
+class EpochDomain {
+ public:
+  // The domain shared by all Titan instances of the process. It is never
+  // destroyed, so threads can hold on to their slot until they exit.
+  static EpochDomain* Default();
+
+  EpochDomain(const EpochDomain&) = delete;
+  EpochDomain& operator=(const EpochDomain&) = delete;
+
+  // Marks the calling thread as reading. Calls nest.
+  void Enter();
+  void Exit();
+
+  // Schedules "deleter" to run once no reader can still see the retired
+  // object. The object must already be unreachable for new readers.
+  void Retire(std::function<void()> deleter);
+
+  // Runs the deleters of retired objects no reader can see anymore.
+  void Reclaim();
+
+  // Returns the current epoch.
+  uint64_t CurrentEpoch() const {
+    return global_epoch_.load(std::memory_order_acquire);
+  }
+
+  // Returns the oldest epoch an active reader entered at, or the current
+  // epoch if there is no active reader. Anything unpublished before an
+  // epoch smaller than the returned one is invisible to all readers.
+  uint64_t MinActiveEpoch() const;
+
+  // Advances the epoch and returns the value before it.
+  uint64_t Advance() {
+    return global_epoch_.fetch_add(1, std::memory_order_acq_rel);
+  }
+
+ private:
+  struct ThreadState;
+
+  EpochDomain() = default;
+
+  // Readers announce the epoch they entered at in a slot of their own;
+  // zero means idle. Slots are padded so readers don't share cache lines.
+  struct Slot {
+    std::atomic<uint64_t> epoch{0};
+    std::atomic<bool> in_use{false};
+    char padding[CACHE_LINE_SIZE - sizeof(std::atomic<uint64_t>) -
+                 sizeof(std::atomic<bool>)];
+  };
+
+  static const size_t kMaxSlots = 1024;
+
+  ThreadState* GetThreadState();
+
+  std::atomic<uint64_t> global_epoch_{1};
+  Slot slots_[kMaxSlots];
+  // Readers without a slot of their own. While there are any nothing is
+  // reclaimed.
+  std::atomic<uint64_t> overflow_readers_{0};
+
+  std::mutex retired_mutex_;
+  // (epoch the object was retired at, deleter), in epoch order.
+  std::deque<std::pair<uint64_t, std::function<void()>>> retired_;
+};
+
+// Keeps lock-free reads of the default domain safe within its scope.
+class EpochGuard {
+ public:
+  EpochGuard() : domain_(EpochDomain::Default()) { domain_->Enter(); }
+  ~EpochGuard() { domain_->Exit(); }
+
+  EpochGuard(const EpochGuard&) = delete;
+  EpochGuard& operator=(const EpochGuard&) = delete;
+
+ private:
+  EpochDomain* domain_;
+};
+
+}  // namespace titandb
+}  // namespace rocksdb
@@ -0,0 +1,85 @@
+#include "epoch.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include "test_util/testharness.h"
+
+namespace rocksdb {
+namespace titandb {
+
+class EpochTest : public testing::Test {};
+
+TEST(EpochTest, RetireWithoutReaders) {
+  EpochDomain* domain = EpochDomain::Default();
+  bool reclaimed = false;
+  domain->Retire([&reclaimed]() { reclaimed = true; });
+  ASSERT_TRUE(reclaimed);
+}
+
+TEST(EpochTest, ReaderBlocksReclaim) {
+  EpochDomain* domain = EpochDomain::Default();
+  std::atomic<bool> reclaimed{false};
+  {
+    EpochGuard guard;
+    domain->Retire([&reclaimed]() { reclaimed = true; });
+    ASSERT_FALSE(reclaimed);
+    {
+      // Nested guards don't release the outer one.
+      EpochGuard nested;
+    }
+    domain->Reclaim();
+    ASSERT_FALSE(reclaimed);
+  }
+  domain->Reclaim();
+  ASSERT_TRUE(reclaimed);
+}
+
+TEST(EpochTest, LaterReaderDoesNotBlockReclaim) {
+  EpochDomain* domain = EpochDomain::Default();
+  std::atomic<bool> entered{false};
+  std::atomic<bool> done{false};
+  std::atomic<bool> reclaimed{false};
+  std::unique_ptr<EpochGuard> guard(new EpochGuard());
+  domain->Retire([&reclaimed]() { reclaimed = true; });
+  ASSERT_FALSE(reclaimed);
+  // Enters after the object was retired, so it can't have seen it.
+  std::thread reader([&]() {
+    EpochGuard reader_guard;
+    entered = true;
+    while (!done) {
+      std::this_thread::yield();
+    }
+  });
+  while (!entered) {
+    std::this_thread::yield();
+  }
+  guard.reset();
+  domain->Reclaim();
+  ASSERT_TRUE(reclaimed);
+  done = true;
+  reader.join();
+}
+
+TEST(EpochTest, MinActiveEpoch) {
+  EpochDomain* domain = EpochDomain::Default();
+  uint64_t min_epoch = 0;
+  {
+    EpochGuard guard;
+    min_epoch = domain->MinActiveEpoch();
+    domain->Advance();
+    domain->Advance();
+    ASSERT_EQ(min_epoch, domain->MinActiveEpoch());
+    ASSERT_LT(min_epoch, domain->CurrentEpoch());
+  }
+  ASSERT_EQ(domain->CurrentEpoch(), domain->MinActiveEpoch());
+}
+
+}  // namespace titandb
+}  // namespace rocksdb
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
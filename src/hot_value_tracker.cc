@@ -0,0 +1,107 @@
+#include "hot_value_tracker.h"
+
+#include <algorithm>
+
+#include "util/mutexlock.h"
+#include "util/random.h"
+
+namespace rocksdb {
+namespace titandb {
+
+namespace {
+
+// Sampled reads within the window of the sketch that make a key hot, and
+// the fewest a member needs to stay hot.
+const uint32_t kHotFrequency = 4;
+const uint32_t kWarmFrequency = 1;
+// Members sampled for the coldest one when making room.
+const int kEvictionSamples = 8;
+const size_t kAssumedValueSize = 1024;
+
+}  // namespace
+
+HotValueTracker::HotValueTracker(uint64_t budget, uint32_t sample_rate)
+    : budget_(budget),
+      sample_rate_(std::max<uint32_t>(sample_rate, 1)),
+      // Tracks a few times more keys than the hot set holds.
+      sketch_(static_cast<size_t>(budget / kAssumedValueSize) * 4) {}
+
+void HotValueTracker::RecordRead(const Slice& key, uint64_t value_size) {
+  if (sample_rate_ > 1 && !Random::GetTLSInstance()->OneIn(sample_rate_)) {
+    return;
+  }
+  sketch_.RecordAccess(key);
+  uint32_t frequency = sketch_.Estimate(key);
+  if (frequency < kHotFrequency || value_size > budget_) {
+    return;
+  }
+  std::string key_str = key.ToString();
+  {
+    ReadLock l(&mutex_);
+    auto it = members_.find(key_str);
+    if (it != members_.end() && it->second.value_size == value_size) {
+      return;
+    }
+  }
+  WriteLock l(&mutex_);
+  Admit(key_str, value_size, frequency);
+}
+
+bool HotValueTracker::IsHot(const Slice& key) const {
+  {
+    ReadLock l(&mutex_);
+    if (members_.count(key.ToString()) == 0) {
+      return false;
+    }
+  }
+  return sketch_.Estimate(key) >= kWarmFrequency;
+}
+
+uint64_t HotValueTracker::hot_bytes() const {
+  ReadLock l(&mutex_);
+  return hot_bytes_;
+}
+
+void HotValueTracker::Admit(const std::string& key, uint64_t value_size,
+                            uint32_t frequency) {
+  auto it = members_.find(key);
+  if (it != members_.end()) {
+    // The value was rewritten with another size.
+    hot_bytes_ -= it->second.value_size;
+    Remove(it->second.index);
+  }
+  Random* rnd = Random::GetTLSInstance();
+  while (hot_bytes_ + value_size > budget_) {
+    size_t victim = keys_.size();
+    uint32_t victim_frequency = frequency;
+    for (int i = 0; i < kEvictionSamples && !keys_.empty(); i++) {
+      size_t index = rnd->Uniform(static_cast<int>(keys_.size()));
+      uint32_t candidate = sketch_.Estimate(keys_[index]);
+      if (candidate < victim_frequency) {
+        victim = index;
+        victim_frequency = candidate;
+      }
+    }
+    if (victim == keys_.size()) {
+      // No member sampled is colder.
+      return;
+    }
+    hot_bytes_ -= members_[keys_[victim]].value_size;
+    Remove(victim);
+  }
+  members_[key] = Member{value_size, keys_.size()};
+  keys_.push_back(key);
+  hot_bytes_ += value_size;
+}
+
+void HotValueTracker::Remove(size_t index) {
+  members_.erase(keys_[index]);
+  if (index + 1 != keys_.size()) {
+    keys_[index] = std::move(keys_.back());
+    members_[keys_[index]].index = index;
+  }
+  keys_.pop_back();
+}
+
+}  // namespace titandb
+}  // namespace rocksdb
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "port/port.h"
+#include "rocksdb/slice.h"
+
+#include "blob_cache_admission.h"
+
+namespace rocksdb {
+namespace titandb {
+
+// Picks the keys whose values are worth inlining back into SSTs, see
+// TitanCFOptions::hot_value_inline_budget. Sampled reads feed a frequency
+// sketch; a key read often enough joins the hot set if its value fits
+// into the budget, evicting colder members if needed. The sketch ages, so
+// keys no longer read cool down and are separated again by compaction.
+class HotValueTracker {
+ public:
+  // Keeps up to "budget" bytes of values hot, sampling one in
+  // "sample_rate" reads.
+  HotValueTracker(uint64_t budget, uint32_t sample_rate);
+
+  HotValueTracker(const HotValueTracker&) = delete;
+  HotValueTracker& operator=(const HotValueTracker&) = delete;
+
+  // Records a read of the value of "key", which is "value_size" bytes.
+  void RecordRead(const Slice& key, uint64_t value_size);
+
+  // Returns true if the value of "key" should be kept in the SST.
+  bool IsHot(const Slice& key) const;
+
+  // Returns the total size of the values of the hot set.
+  uint64_t hot_bytes() const;
+
+ private:
+  struct Member {
+    uint64_t value_size;
+    // Position in "keys_".
+    size_t index;
+  };
+
+  // Adds "key" to the hot set if it is hotter than the members it would
+  // have to evict.
+  // REQUIRES: mutex_ held for write
+  void Admit(const std::string& key, uint64_t value_size, uint32_t frequency);
+
+  // REQUIRES: mutex_ held for write
+  void Remove(size_t index);
+
+  const uint64_t budget_;
+  const uint32_t sample_rate_;
+  FrequencySketch sketch_;
+
+  mutable port::RWMutex mutex_;
+  std::unordered_map<std::string, Member> members_;
+  // The keys of the members, to sample eviction victims from.
+  std::vector<std::string> keys_;
+  uint64_t hot_bytes_{0};
+};
+
+}  // namespace titandb
+}  // namespace rocksdb
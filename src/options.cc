@@ -27,6 +27,44 @@ void TitanDBOptions::Dump(Logger* logger) const {
   ROCKS_LOG_HEADER(logger,
                    "TitanDBOptions.titan_stats_dump_period_sec: %" PRIu32,
                    titan_stats_dump_period_sec);
+  ROCKS_LOG_HEADER(logger,
+                   "TitanDBOptions.num_blob_read_threads      : %" PRIi32,
+                   num_blob_read_threads);
+  ROCKS_LOG_HEADER(logger,
+                   "TitanDBOptions.blob_io_uring_queue_depth  : %" PRIu32,
+                   blob_io_uring_queue_depth);
+  ROCKS_LOG_HEADER(logger,
+                   "TitanDBOptions.preload_blob_file_readers  : %d",
+                   static_cast<int>(preload_blob_file_readers));
+  ROCKS_LOG_HEADER(logger,
+                   "TitanDBOptions.max_open_blob_files        : %d",
+                   max_open_blob_files);
+  ROCKS_LOG_HEADER(logger,
+                   "TitanDBOptions.blob_file_cache_num_shard_bits: %d",
+                   blob_file_cache_num_shard_bits);
+  ROCKS_LOG_HEADER(logger,
+                   "TitanDBOptions.use_direct_blob_reads      : %d",
+                   static_cast<int>(use_direct_blob_reads));
+  ROCKS_LOG_HEADER(
+      logger, "TitanDBOptions.blob_direct_read_buffer_pool_size: %" PRIu64,
+      blob_direct_read_buffer_pool_size);
+  ROCKS_LOG_HEADER(logger, "TitanDBOptions.blob_flash_cache_path      : %s",
+                   blob_flash_cache_path.c_str());
+  ROCKS_LOG_HEADER(logger,
+                   "TitanDBOptions.blob_flash_cache_size      : %" PRIu64,
+                   blob_flash_cache_size);
+  ROCKS_LOG_HEADER(logger,
+                   "TitanDBOptions.blob_cache_dump_period_sec : %" PRIu32,
+                   blob_cache_dump_period_sec);
+  ROCKS_LOG_HEADER(
+      logger, "TitanDBOptions.blob_cache_warmup_bytes_per_sec: %" PRIu64,
+      blob_cache_warmup_bytes_per_sec);
+  ROCKS_LOG_HEADER(logger, "TitanDBOptions.titan_row_cache            : %p",
+                   titan_row_cache.get());
+  if (titan_row_cache != nullptr) {
+    ROCKS_LOG_HEADER(logger, "%s",
+                     titan_row_cache->GetPrintableOptions().c_str());
+  }
 }
 
 TitanCFOptions::TitanCFOptions(const ColumnFamilyOptions& cf_opts,
@@ -37,6 +75,22 @@ TitanCFOptions::TitanCFOptions(const ColumnFamilyOptions& cf_opts,
       blob_file_compression(immutable_opts.blob_file_compression),
       blob_file_target_size(immutable_opts.blob_file_target_size),
       blob_cache(immutable_opts.blob_cache),
+      blob_cache_admission(immutable_opts.blob_cache_admission),
+      blob_compressed_cache(immutable_opts.blob_compressed_cache),
+      blob_compressed_cache_compression(
+          immutable_opts.blob_compressed_cache_compression),
+      blob_read_coalesce_gap(immutable_opts.blob_read_coalesce_gap),
+      compact_blob_index(immutable_opts.compact_blob_index),
+      blob_checksum_policy(immutable_opts.blob_checksum_policy),
+      blob_checksum_sample_interval(
+          immutable_opts.blob_checksum_sample_interval),
+      mmap_sorted_blob_files(immutable_opts.mmap_sorted_blob_files),
+      mmap_blob_file_min_level(immutable_opts.mmap_blob_file_min_level),
+      hot_value_inline_budget(immutable_opts.hot_value_inline_budget),
+      hot_value_max_size(immutable_opts.hot_value_max_size),
+      hot_value_sample_rate(immutable_opts.hot_value_sample_rate),
+      blob_chunk_size(immutable_opts.blob_chunk_size),
+      chunked_value_min_size(immutable_opts.chunked_value_min_size),
       max_gc_batch_size(immutable_opts.max_gc_batch_size),
       min_gc_batch_size(immutable_opts.min_gc_batch_size),
       blob_file_discardable_ratio(immutable_opts.blob_file_discardable_ratio),
@@ -65,6 +119,53 @@ void TitanCFOptions::Dump(Logger* logger) const {
   if (blob_cache != nullptr) {
     ROCKS_LOG_HEADER(logger, "%s", blob_cache->GetPrintableOptions().c_str());
   }
+  ROCKS_LOG_HEADER(logger, "TitanCFOptions.blob_cache_admission         : %d",
+                   static_cast<int>(blob_cache_admission));
+  ROCKS_LOG_HEADER(logger, "TitanCFOptions.blob_compressed_cache        : %p",
+                   blob_compressed_cache.get());
+  if (blob_compressed_cache != nullptr) {
+    ROCKS_LOG_HEADER(logger, "%s",
+                     blob_compressed_cache->GetPrintableOptions().c_str());
+  }
+  compression_str = "unknown";
+  for (auto& compression_type : compression_type_string_map) {
+    if (compression_type.second == blob_compressed_cache_compression) {
+      compression_str = compression_type.first;
+      break;
+    }
+  }
+  ROCKS_LOG_HEADER(logger,
+                   "TitanCFOptions.blob_compressed_cache_compression: %s",
+                   compression_str.c_str());
+  ROCKS_LOG_HEADER(logger,
+                   "TitanCFOptions.blob_read_coalesce_gap       : %" PRIu64,
+                   blob_read_coalesce_gap);
+  ROCKS_LOG_HEADER(logger, "TitanCFOptions.compact_blob_index           : %d",
+                   static_cast<int>(compact_blob_index));
+  ROCKS_LOG_HEADER(logger, "TitanCFOptions.blob_checksum_policy         : %d",
+                   static_cast<int>(blob_checksum_policy));
+  ROCKS_LOG_HEADER(logger,
+                   "TitanCFOptions.blob_checksum_sample_interval: %" PRIu32,
+                   blob_checksum_sample_interval);
+  ROCKS_LOG_HEADER(logger, "TitanCFOptions.mmap_sorted_blob_files       : %d",
+                   static_cast<int>(mmap_sorted_blob_files));
+  ROCKS_LOG_HEADER(logger, "TitanCFOptions.mmap_blob_file_min_level     : %d",
+                   mmap_blob_file_min_level);
+  ROCKS_LOG_HEADER(logger,
+                   "TitanCFOptions.hot_value_inline_budget      : %" PRIu64,
+                   hot_value_inline_budget);
+  ROCKS_LOG_HEADER(logger,
+                   "TitanCFOptions.hot_value_max_size           : %" PRIu64,
+                   hot_value_max_size);
+  ROCKS_LOG_HEADER(logger,
+                   "TitanCFOptions.hot_value_sample_rate        : %" PRIu32,
+                   hot_value_sample_rate);
+  ROCKS_LOG_HEADER(logger,
+                   "TitanCFOptions.blob_chunk_size              : %" PRIu64,
+                   blob_chunk_size);
+  ROCKS_LOG_HEADER(logger,
+                   "TitanCFOptions.chunked_value_min_size       : %" PRIu64,
+                   chunked_value_min_size);
   ROCKS_LOG_HEADER(logger,
                    "TitanCFOptions.max_gc_batch_size            : %" PRIu64,
                    max_gc_batch_size);
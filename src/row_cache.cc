@@ -0,0 +1,84 @@
+#include "row_cache.h"
+
+#include "util/coding.h"
+#include "util/hash.h"
+
+#include "util.h"
+
+namespace rocksdb {
+namespace titandb {
+
+struct RowCache::Entry {
+  uint64_t version;
+  std::string value;
+};
+
+RowCache::RowCache(std::shared_ptr<Cache> cache)
+    : cache_(std::move(cache)),
+      versions_(new std::atomic<uint64_t>[kNumStripes]) {
+  for (size_t i = 0; i < kNumStripes; i++) {
+    versions_[i].store(0, std::memory_order_relaxed);
+  }
+  PutVarint64(&prefix_, cache_->NewId());
+}
+
+size_t RowCache::Stripe(uint32_t cf_id, const Slice& key) const {
+  return Hash(key.data(), key.size(), cf_id) % kNumStripes;
+}
+
+void RowCache::EncodeKey(uint32_t cf_id, const Slice& key,
+                         std::string* dst) const {
+  dst->reserve(prefix_.size() + 5 + key.size());
+  dst->assign(prefix_);
+  PutVarint32(dst, cf_id);
+  dst->append(key.data(), key.size());
+}
+
+uint64_t RowCache::Version(uint32_t cf_id, const Slice& key) const {
+  // Both only grow, so their sum changes whenever either does.
+  return generation_.load(std::memory_order_acquire) +
+         versions_[Stripe(cf_id, key)].load(std::memory_order_acquire);
+}
+
+bool RowCache::Lookup(uint32_t cf_id, const Slice& key,
+                      PinnableSlice* value) {
+  std::string cache_key;
+  EncodeKey(cf_id, key, &cache_key);
+  Cache::Handle* handle = cache_->Lookup(cache_key);
+  if (handle == nullptr) {
+    return false;
+  }
+  auto entry = reinterpret_cast<Entry*>(cache_->Value(handle));
+  if (entry->version != Version(cf_id, key)) {
+    // Written since, drops the stale value right away.
+    cache_->Release(handle, true /*force_erase*/);
+    return false;
+  }
+  value->Reset();
+  value->PinSlice(entry->value, UnrefCacheHandle, cache_.get(), handle);
+  return true;
+}
+
+void RowCache::Insert(uint32_t cf_id, const Slice& key, uint64_t version,
+                      const Slice& value) {
+  if (version != Version(cf_id, key)) {
+    // Already stale.
+    return;
+  }
+  std::string cache_key;
+  EncodeKey(cf_id, key, &cache_key);
+  Entry* entry = new Entry{version, value.ToString()};
+  cache_->Insert(cache_key, entry, sizeof(Entry) + value.size(),
+                 &DeleteCacheValue<Entry>);
+}
+
+void RowCache::Invalidate(uint32_t cf_id, const Slice& key) {
+  versions_[Stripe(cf_id, key)].fetch_add(1, std::memory_order_release);
+}
+
+void RowCache::InvalidateAll() {
+  generation_.fetch_add(1, std::memory_order_release);
+}
+
+}  // namespace titandb
+}  // namespace rocksdb
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "rocksdb/cache.h"
+#include "rocksdb/slice.h"
+
+namespace rocksdb {
+namespace titandb {
+
+// Caches the values of user keys as read at the latest sequence, with
+// blob indexes resolved, so that hot keys are served without touching the
+// LSM or the blob files. Writes invalidate keys through version stamps
+// rather than erasing entries: every key maps to one of a fixed number of
+// stripes whose version is bumped after a write to a key in it has been
+// applied, and an entry is only served if it was filled at the current
+// version of its stripe. Rewrites of blob indexes by GC and level merge
+// don't change values and need no invalidation.
+class RowCache {
+ public:
+  explicit RowCache(std::shared_ptr<Cache> cache);
+
+  RowCache(const RowCache&) = delete;
+  RowCache& operator=(const RowCache&) = delete;
+
+  // Returns the version stamp to fill "key" of "cf_id" with. Must be
+  // taken before the value is read.
+  uint64_t Version(uint32_t cf_id, const Slice& key) const;
+
+  // Looks up "key" of "cf_id". On a hit, pins the value in "value" and
+  // returns true.
+  bool Lookup(uint32_t cf_id, const Slice& key, PinnableSlice* value);
+
+  // Caches "value" of "key" of "cf_id", read after taking "version".
+  void Insert(uint32_t cf_id, const Slice& key, uint64_t version,
+              const Slice& value);
+
+  // Invalidates the cached value of "key" of "cf_id". Must be called
+  // after the write to it has been applied.
+  void Invalidate(uint32_t cf_id, const Slice& key);
+
+  // Invalidates all cached values, e.g. after a range of keys is deleted.
+  void InvalidateAll();
+
+ private:
+  struct Entry;
+
+  static const size_t kNumStripes = 4096;
+
+  size_t Stripe(uint32_t cf_id, const Slice& key) const;
+
+  void EncodeKey(uint32_t cf_id, const Slice& key, std::string* dst) const;
+
+  std::shared_ptr<Cache> cache_;
+  // Keeps the keys of this cache apart from other users of "cache_".
+  std::string prefix_;
+  std::atomic<uint64_t> generation_{0};
+  std::unique_ptr<std::atomic<uint64_t>[]> versions_;
+};
+
+}  // namespace titandb
+}  // namespace rocksdb
@@ -45,6 +45,14 @@ void TitanTableBuilder::Add(const Slice &key, const Slice &value) {
   uint64_t prev_bytes_written = 0;
   SavePrevIOBytes(&prev_bytes_read, &prev_bytes_written);
 
+  if (ikey.type == kTypeBlobIndex &&
+      cf_options_.blob_run_mode == TitanBlobRunMode::kNormal &&
+      IsHotValue(ikey.user_key) && InlineHotValue(ikey, value)) {
+    UpdateIOBytes(prev_bytes_read, prev_bytes_written, &io_bytes_read_,
+                  &io_bytes_written_);
+    return;
+  }
+
   if (ikey.type == kTypeBlobIndex &&
       cf_options_.blob_run_mode == TitanBlobRunMode::kFallback) {
     // std::cerr<<"fall back"<<std::endl;
@@ -78,6 +86,14 @@ void TitanTableBuilder::Add(const Slice &key, const Slice &value) {
       // TODO: return error if it is indeed an error.
       base_builder_->Add(key, value);
     }
+  } else if (ikey.type == kTypeValue &&
+             value.size() >= cf_options_.min_blob_size &&
+             value.size() <= cf_options_.hot_value_max_size &&
+             cf_options_.blob_run_mode == TitanBlobRunMode::kNormal &&
+             IsHotValue(ikey.user_key)) {
+    // Hot values stay in the SST until they cool down.
+    RecordTick(stats_, TitanStats::HOT_VALUE_KEPT_INLINE);
+    base_builder_->Add(key, value);
   } else if (ikey.type == kTypeValue &&
              value.size() >= cf_options_.min_blob_size &&
              cf_options_.blob_run_mode == TitanBlobRunMode::kNormal) {
@@ -127,6 +143,7 @@ void TitanTableBuilder::Add(const Slice &key, const Slice &value) {
           base_builder_->Add(key, value);
           return;
         }
+        prefetcher->SetForCompaction(true);
         it = merging_files_.emplace(index.file_number, std::move(prefetcher))
                  .first;
       }
@@ -160,6 +177,41 @@ void TitanTableBuilder::Add(const Slice &key, const Slice &value) {
   }
 }
 
+bool TitanTableBuilder::IsHotValue(const Slice &user_key) {
+  if (cf_options_.hot_value_inline_budget == 0) {
+    return false;
+  }
+  auto storage = blob_storage_.lock();
+  return storage != nullptr && storage->IsHotValue(user_key);
+}
+
+bool TitanTableBuilder::InlineHotValue(ParsedInternalKey ikey,
+                                       const Slice &value) {
+  BlobIndex index;
+  Slice copy = value;
+  if (!index.DecodeFrom(&copy).ok()) {
+    return false;
+  }
+  auto storage = blob_storage_.lock();
+  assert(storage != nullptr);
+  BlobRecord record;
+  PinnableSlice buffer;
+  ReadOptions options;
+  options.fill_cache = false;
+  Status s = storage->Get(options, index, &record, &buffer);
+  if (!s.ok()) {
+    // Keeps the blob index, e.g. the blob file has been GC-ed.
+    return false;
+  }
+  ikey.type = kTypeValue;
+  std::string value_key;
+  AppendInternalKey(&value_key, ikey);
+  base_builder_->Add(value_key, record.value);
+  bytes_read_ += record.size();
+  RecordTick(stats_, TitanStats::HOT_VALUE_INLINED);
+  return true;
+}
+
 void TitanTableBuilder::AddBlob(const Slice &key, const Slice &value,
                                 std::string *index_value) {
   if (!ok()) return;
@@ -187,12 +239,12 @@ void TitanTableBuilder::AddBlob(const Slice &key, const Slice &value,
   if (cf_options_.level_merge) record.only_value = true;
   record.key = key;
   record.value = value;
-  blob_builder_->Add(record, &index.blob_handle);
+  blob_builder_->Add(record, &index);
   // RecordTick(stats_, BLOB_DB_BLOB_FILE_BYTES_WRITTEN,
   // index.blob_handle.size);
   bytes_written_ += record.size();
   if (ok()) {
-    index.EncodeTo(index_value);
+    index.EncodeTo(index_value, cf_options_.compact_blob_index);
     if (blob_handle_->GetFile()->GetFileSize() >=
         cf_options_.blob_file_target_size) {
       FinishBlobFile();
@@ -378,7 +430,7 @@ void ForegroundBuilder::handleRequest(int b) {
         blob_record.value = req->val;
         BlobIndex blob_index;
         blob_index.file_number = handle_[b]->GetNumber();
-        builder_[b]->Add(blob_record, &blob_index.blob_handle);
+        builder_[b]->Add(blob_record, &blob_index);
         AddStats(stats_, cf_id_, TitanInternalStats::LIVE_BLOB_SIZE, req->val.size());
 
         if (handle_[b]->GetFile()->GetFileSize() >=
@@ -386,7 +438,7 @@ void ForegroundBuilder::handleRequest(int b) {
           FinishBlob(b);
         }
         std::string index_entry;
-        blob_index.EncodeTo(&index_entry);
+        blob_index.EncodeTo(&index_entry, cf_options_.compact_blob_index);
 
         s = WriteBatchInternal::PutBlobIndex(req->wb, cf_id_, blob_record.key,
                                              index_entry);
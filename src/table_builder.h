@@ -60,6 +60,14 @@ class TitanTableBuilder : public TableBuilder {
 
   void AddBlob(const Slice &key, const Slice &value, std::string *index_value);
 
+  // Returns true if the value of "user_key" is hot, see
+  // TitanCFOptions::hot_value_inline_budget.
+  bool IsHotValue(const Slice &user_key);
+
+  // Adds the hot value pointed by the blob index "value" to the SST in
+  // place of the index. Returns false if it can't be read.
+  bool InlineHotValue(ParsedInternalKey ikey, const Slice &value);
+
   bool ShouldMerge(const std::shared_ptr<BlobFileMeta> &file);
 
   void FinishBlobFile();
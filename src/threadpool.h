@@ -55,6 +55,8 @@ class ThreadPool {
     }
   }
 
+  size_t threadCount() const { return workers.size(); }
+
   // add a task to queue, return a future struct witch contains the return value
   // of the task
   template <class Func, class... Args>
@@ -86,5 +88,5 @@ class ThreadPool {
   // for workers coordination
   std::condition_variable cond;
   // termination sign
-  bool terminated;
+  bool terminated{false};
 };
\ No newline at end of file
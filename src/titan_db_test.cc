@@ -5,6 +5,7 @@
 #include "db/db_impl/db_impl.h"
 #include "file/filename.h"
 #include "port/port.h"
+#include "rocksdb/rate_limiter.h"
 #include "rocksdb/utilities/debug.h"
 #include "test_util/sync_point.h"
 #include "test_util/testharness.h"
@@ -155,6 +156,14 @@ class TitanDBTest : public testing::Test {
     return db_impl_->blob_file_set_->GetBlobStorage(cf_handle->GetID());
   }
 
+  size_t NumOpenBlobFileReaders() {
+    return db_impl_->blob_file_set_->file_cache_->GetUsage();
+  }
+
+  uint64_t GetTickerCount(uint32_t ticker) {
+    return db_impl_->stats_->getTickerCount(ticker);
+  }
+
   ColumnFamilyHandle* GetColumnFamilyHandle(uint32_t cf_id) {
     return db_impl_->db_impl_->GetColumnFamilyHandleUnlocked(cf_id).release();
   }
@@ -793,6 +802,7 @@ TEST_F(TitanDBTest, CompactionWriteIOErrorHandling) {
 
 TEST_F(TitanDBTest, BlobFileCorruptionErrorHandling) {
   options_.disable_background_gc = true;  // avoid abort by BackgroundGC
+  options_.blob_checksum_policy = TitanBlobChecksumPolicy::kOnRead;
   Open();
   std::map<std::string, std::string> data;
   const int kNumEntries = 100;
@@ -806,7 +816,7 @@ TEST_F(TitanDBTest, BlobFileCorruptionErrorHandling) {
 
   // Modify the checksum data to reproduce a mismatch
   SyncPoint::GetInstance()->SetCallBack(
-      "BlobDecoder::DecodeRecord", [&](void* arg) {
+      "BlobDecoder::VerifyChecksum", [&](void* arg) {
         auto* crc = reinterpret_cast<uint32_t*>(arg);
         *crc = *crc + 1;
       });
@@ -1200,6 +1210,698 @@ TEST_F(TitanDBTest, GCBeforeFlushCommit) {
   SyncPoint::GetInstance()->ClearAllCallBacks();
 }
 
+TEST_F(TitanDBTest, MultiGetAcrossBlobFiles) {
+  options_.num_blob_read_threads = 4;
+  Open();
+  std::map<std::string, std::string> data;
+  // Every flush generates a new blob file.
+  for (uint64_t i = 0; i < 4; i++) {
+    for (uint64_t k = i * 50; k < (i + 1) * 50; k++) {
+      Put(k, &data);
+    }
+    Flush();
+  }
+  // Keys from memtable are mixed with keys from blob files.
+  Put(1000, &data);
+
+  std::vector<Slice> keys;
+  std::vector<ColumnFamilyHandle*> handles;
+  for (auto& kv : data) {
+    keys.emplace_back(kv.first);
+    handles.emplace_back(db_->DefaultColumnFamily());
+  }
+  keys.emplace_back("non-exist");
+  handles.emplace_back(db_->DefaultColumnFamily());
+
+  std::vector<std::string> values;
+  auto res = db_->MultiGet(ReadOptions(), handles, keys, &values);
+  ASSERT_EQ(keys.size(), res.size());
+  size_t i = 0;
+  for (auto& kv : data) {
+    ASSERT_OK(res[i]);
+    ASSERT_EQ(kv.second, values[i]);
+    i++;
+  }
+  ASSERT_TRUE(res[i].IsNotFound());
+  Close();
+}
+
+// Neighbouring records fetched with a single read and inserted into the
+// blob cache must stay readable once the read buffer is gone.
+TEST_F(TitanDBTest, CoalescedReadsWithBlobCache) {
+  options_.min_blob_size = 0;
+  options_.blob_file_compression = kNoCompression;
+  options_.blob_cache = NewLRUCache(1 << 20);
+  options_.blob_read_coalesce_gap = 64 << 10;
+  Open();
+  std::map<std::string, std::string> data;
+  for (uint64_t k = 0; k < 20; k++) {
+    Put(k, &data);
+  }
+  Flush();
+
+  std::vector<Slice> keys;
+  std::vector<ColumnFamilyHandle*> handles;
+  for (auto& kv : data) {
+    keys.emplace_back(kv.first);
+    handles.emplace_back(db_->DefaultColumnFamily());
+  }
+  std::vector<std::string> values;
+  auto res = db_->MultiGet(ReadOptions(), handles, keys, &values);
+  size_t i = 0;
+  for (auto& kv : data) {
+    ASSERT_OK(res[i]);
+    ASSERT_EQ(kv.second, values[i]);
+    i++;
+  }
+
+  // Scan with an empty blob cache.
+  options_.blob_cache = NewLRUCache(1 << 20);
+  Reopen();
+  std::vector<std::string> scan_keys;
+  std::vector<std::string> scan_values;
+  ASSERT_EQ(20, db_->Scan(ReadOptions(), GenKey(0), 20, scan_keys,
+                          scan_values));
+  i = 0;
+  for (auto& kv : data) {
+    ASSERT_EQ(kv.first, scan_keys[i]);
+    ASSERT_EQ(kv.second, scan_values[i]);
+    i++;
+  }
+}
+
+TEST_F(TitanDBTest, ScanAcrossBlobFiles) {
+  options_.num_blob_read_threads = 2;
+  Open();
+  std::map<std::string, std::string> data;
+  // Every flush generates a new blob file, keys of the files interleave.
+  for (uint64_t i = 0; i < 4; i++) {
+    for (uint64_t k = i; k < 200; k += 4) {
+      Put(k, &data);
+    }
+    Flush();
+  }
+  Put(1000, &data);
+
+  for (uint32_t fan_out : {0, 1, 3, 16}) {
+    TitanReadOptions ropts;
+    ropts.scan_fan_out = fan_out;
+    ropts.scan_coalesce_gap = fan_out > 1 ? 64 << 10 : 0;
+    std::vector<std::string> keys;
+    std::vector<std::string> values;
+    int len = db_->Scan(ropts, GenKey(10), 100, keys, values);
+    ASSERT_EQ(100, len);
+    auto it = data.find(GenKey(10));
+    for (int i = 0; i < len; i++, it++) {
+      ASSERT_EQ(it->first, keys[i]);
+      ASSERT_EQ(it->second, values[i]);
+    }
+  }
+  // Runs off the end.
+  std::vector<std::string> keys;
+  std::vector<std::string> values;
+  ASSERT_EQ(2, db_->Scan(ReadOptions(), GenKey(199), 100, keys, values));
+  ASSERT_EQ(data[GenKey(1000)], values[1]);
+  Close();
+}
+
+TEST_F(TitanDBTest, IteratorLookahead) {
+  for (int32_t read_threads : {0, 2}) {
+    options_.num_blob_read_threads = read_threads;
+    Open();
+    std::map<std::string, std::string> data;
+    for (uint64_t i = 0; i < 4; i++) {
+      for (uint64_t k = i; k < 200; k += 4) {
+        Put(k, &data);
+      }
+      Flush();
+    }
+    // Entries the lookahead walks past without reading.
+    for (uint64_t k = 50; k < 60; k++) {
+      Delete(k);
+      data.erase(GenKey(k));
+    }
+
+    TitanReadOptions ropts;
+    ropts.iterator_lookahead = 16;
+    std::string upper_bound = GenKey(150);
+    Slice upper(upper_bound);
+    ropts.iterate_upper_bound = &upper;
+    std::unique_ptr<Iterator> iter(db_->NewIterator(ropts));
+    auto it = data.begin();
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), it++) {
+      ASSERT_EQ(it->first, iter->key().ToString());
+      ASSERT_EQ(it->second, iter->value().ToString());
+    }
+    ASSERT_OK(iter->status());
+    ASSERT_EQ(data.find(upper_bound), it);
+
+    // Changes direction and back.
+    iter->Seek(GenKey(100));
+    for (int i = 0; i < 5; i++) {
+      iter->Next();
+    }
+    iter->Prev();
+    iter->Prev();
+    ASSERT_TRUE(iter->Valid());
+    it = data.find(iter->key().ToString());
+    for (; iter->Valid(); iter->Next(), it++) {
+      ASSERT_EQ(it->first, iter->key().ToString());
+      ASSERT_EQ(it->second, iter->value().ToString());
+    }
+    ASSERT_OK(iter->status());
+    // Left with reads in flight.
+    iter->Seek(GenKey(0));
+    iter.reset();
+    Close();
+    DeleteDir(env_, options_.dirname);
+    DeleteDir(env_, dbname_);
+  }
+}
+
+TEST_F(TitanDBTest, LazyValue) {
+  options_.min_blob_size = 0;
+  // The value size property is then exact without reading the value.
+  options_.compact_blob_index = true;
+  options_.blob_file_compression = kNoCompression;
+  options_.blob_cache = NewLRUCache(1 << 20);
+  options_.num_blob_read_threads = 2;
+  Open();
+  std::map<std::string, std::string> data;
+  for (uint64_t k = 0; k < 100; k++) {
+    Put(k, &data);
+  }
+  Flush();
+
+  TitanReadOptions ropts;
+  ropts.lazy_value = true;
+  std::unique_ptr<Iterator> iter(db_->NewIterator(ropts));
+  auto titan_iter = static_cast<TitanIterator*>(iter.get());
+  uint64_t misses = GetTickerCount(TitanStats::BLOB_CACHE_MISS);
+  int i = 0;
+  auto it = data.begin();
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next(), it++, i++) {
+    ASSERT_EQ(it->first, iter->key().ToString());
+    if (i % 4 == 1) {
+      titan_iter->PrefetchValue();
+    } else if (i % 4 != 2) {
+      ASSERT_FALSE(titan_iter->IsValueLoaded());
+      continue;
+    }
+    std::string size;
+    ASSERT_OK(iter->GetProperty(TitanDB::Properties::kIteratorValueSize,
+                                &size));
+    ASSERT_EQ(ToString(it->second.size()), size);
+    ASSERT_EQ(it->second, iter->value().ToString());
+    ASSERT_TRUE(titan_iter->IsValueLoaded());
+  }
+  ASSERT_OK(iter->status());
+  ASSERT_EQ(data.size(), static_cast<size_t>(i));
+  // Only the values asked for are read.
+  ASSERT_EQ(misses + 50, GetTickerCount(TitanStats::BLOB_CACHE_MISS));
+
+  // Left with a read in flight.
+  iter->SeekToFirst();
+  titan_iter->PrefetchValue();
+  iter->Next();
+  iter.reset();
+}
+
+// A Get without snapshot must still be able to read a blob file that GC
+// made obsolete after the Get had read the blob index.
+TEST_F(TitanDBTest, GetWithoutSnapshotDuringPurge) {
+  options_.disable_background_gc = true;
+  options_.blob_file_discardable_ratio = 0.01;
+  options_.min_blob_size = 0;
+  Open();
+  ASSERT_OK(db_->Put(WriteOptions(), "foo", "v1"));
+  ASSERT_OK(db_->Put(WriteOptions(), "bar", "v1"));
+  ASSERT_OK(db_->Flush(FlushOptions()));
+  ASSERT_EQ(1, GetBlobStorage().lock()->NumBlobFiles());
+
+  SyncPoint::GetInstance()->LoadDependency(
+      {{"TitanDBImpl::GetImpl:AfterBaseDBGet",
+        "TitanDBTest::GetWithoutSnapshotDuringPurge:GC"},
+       {"TitanDBTest::GetWithoutSnapshotDuringPurge:Purged",
+        "BlobFileReader::Get"}});
+  SyncPoint::GetInstance()->EnableProcessing();
+
+  std::string value;
+  Status get_status;
+  port::Thread reader([&]() {
+    get_status = db_->Get(ReadOptions(), "foo", &value);
+  });
+
+  TEST_SYNC_POINT("TitanDBTest::GetWithoutSnapshotDuringPurge:GC");
+  ASSERT_OK(db_->Delete(WriteOptions(), "foo"));
+  ASSERT_OK(db_->Flush(FlushOptions()));
+  ASSERT_OK(db_->CompactRange(CompactRangeOptions(), nullptr, nullptr));
+  uint32_t default_cf_id = db_->DefaultColumnFamily()->GetID();
+  ASSERT_OK(db_impl_->TEST_StartGC(default_cf_id));
+  ASSERT_EQ(2, GetBlobStorage().lock()->NumBlobFiles());
+  // The reader still holds an index into the obsolete file.
+  ASSERT_OK(db_impl_->TEST_PurgeObsoleteFiles());
+  ASSERT_EQ(2, GetBlobStorage().lock()->NumBlobFiles());
+  TEST_SYNC_POINT("TitanDBTest::GetWithoutSnapshotDuringPurge:Purged");
+
+  reader.join();
+  SyncPoint::GetInstance()->DisableProcessing();
+  SyncPoint::GetInstance()->ClearAllCallBacks();
+  ASSERT_OK(get_status);
+  ASSERT_EQ("v1", value);
+
+  ASSERT_OK(db_impl_->TEST_PurgeObsoleteFiles());
+  ASSERT_EQ(1, GetBlobStorage().lock()->NumBlobFiles());
+  Close();
+}
+
+TEST_F(TitanDBTest, PinnedBlobValues) {
+  options_.blob_cache = NewLRUCache(1 << 20);
+  Open();
+  std::map<std::string, std::string> data;
+  for (uint64_t k = 0; k < 20; k++) {
+    Put(k, &data);
+  }
+  Flush();
+
+  // Blob values are handed over pinned, from the blob cache on the second
+  // round.
+  for (int round = 0; round < 2; round++) {
+    for (auto& kv : data) {
+      PinnableSlice value;
+      ASSERT_OK(db_->Get(ReadOptions(), db_->DefaultColumnFamily(), kv.first,
+                         &value));
+      ASSERT_TRUE(value.IsPinned());
+      ASSERT_EQ(kv.second, value.ToString());
+    }
+  }
+
+  std::vector<Slice> keys;
+  for (auto& kv : data) {
+    keys.emplace_back(kv.first);
+  }
+  std::unique_ptr<PinnableSlice[]> values(new PinnableSlice[keys.size()]);
+  std::vector<Status> statuses(keys.size());
+  db_->MultiGet(ReadOptions(), db_->DefaultColumnFamily(), keys.size(),
+                keys.data(), values.get(), statuses.data());
+  size_t i = 0;
+  for (auto& kv : data) {
+    ASSERT_OK(statuses[i]);
+    ASSERT_TRUE(values[i].IsPinned());
+    ASSERT_EQ(kv.second, values[i].ToString());
+    i++;
+  }
+  Close();
+}
+
+TEST_F(TitanDBTest, GetWithDeadline) {
+  Open();
+  ASSERT_OK(db_->Put(WriteOptions(), "foo", std::string(4096, 'v')));
+  Flush();
+
+  TitanReadOptions ro;
+  PinnableSlice value;
+  ro.deadline = env_->NowMicros() + 3600 * 1000000ull;
+  ASSERT_OK(db_->Get(ro, db_->DefaultColumnFamily(), "foo", &value));
+  ASSERT_EQ(std::string(4096, 'v'), value.ToString());
+
+  value.Reset();
+  ro.deadline = 1;
+  ASSERT_TRUE(
+      db_->Get(ro, db_->DefaultColumnFamily(), "foo", &value).IsTimedOut());
+  Close();
+}
+
+TEST_F(TitanDBTest, PreloadBlobFileReaders) {
+  const uint64_t kNumFiles = 4;
+  const uint64_t kNumKeysPerFile = 10;
+  std::map<std::string, std::string> data;
+  Open();
+  for (uint64_t f = 0; f < kNumFiles; f++) {
+    for (uint64_t i = 0; i < kNumKeysPerFile; i++) {
+      Put(f * kNumKeysPerFile + i, &data);
+    }
+    Flush();
+  }
+  uint64_t num_blob_files = GetBlobStorage().lock()->NumBlobFiles();
+  ASSERT_EQ(kNumFiles, num_blob_files);
+
+  options_.preload_blob_file_readers = true;
+  options_.max_file_opening_threads = 2;
+  options_.max_open_blob_files = 100;
+  options_.blob_file_cache_num_shard_bits = 2;
+  Reopen();
+  ASSERT_EQ(num_blob_files, NumOpenBlobFileReaders());
+  VerifyDB(data);
+  ASSERT_EQ(num_blob_files, NumOpenBlobFileReaders());
+}
+
+TEST_F(TitanDBTest, CompactBlobIndex) {
+  const uint64_t kNumKeys = 100;
+  std::map<std::string, std::string> data;
+  options_.blob_file_compression = kNoCompression;
+  Open();
+  for (uint64_t k = 0; k < kNumKeys; k++) {
+    Put(k, &data);
+  }
+  Flush();
+
+  // Indexes of both formats coexist.
+  options_.compact_blob_index = true;
+  Reopen();
+  for (uint64_t k = kNumKeys; k < kNumKeys * 2; k++) {
+    Put(k, &data);
+  }
+  Flush();
+  VerifyDB(data);
+
+  options_.blob_cache = NewLRUCache(1 << 20);
+  options_.blob_file_compression = CompressionType::kLZ4Compression;
+  Reopen();
+  for (uint64_t k = kNumKeys * 2; k < kNumKeys * 3; k++) {
+    Put(k, &data);
+  }
+  Flush();
+  VerifyDB(data);
+  // Served from the blob cache this time.
+  VerifyDB(data);
+}
+
+TEST_F(TitanDBTest, GetPartial) {
+  options_.blob_file_compression = kNoCompression;
+  options_.compact_blob_index = true;
+  options_.blob_cache = NewLRUCache(1 << 20);
+  Open();
+  std::string blob_value;
+  for (int i = 0; i < 1000; i++) {
+    blob_value.push_back(static_cast<char>('a' + i % 26));
+  }
+  std::string inline_value = blob_value.substr(0, options_.min_blob_size - 1);
+  ASSERT_OK(db_->Put(WriteOptions(), "blob", blob_value));
+  ASSERT_OK(db_->Put(WriteOptions(), "inline", inline_value));
+  Flush();
+
+  auto check = [&](const std::string& key, const std::string& expected) {
+    const uint64_t kRanges[][2] = {
+        {0, 10}, {7, 100}, {990, 100}, {0, 1000}, {1000, 1}, {5000, 1}};
+    for (const auto& range : kRanges) {
+      PinnableSlice value;
+      ASSERT_OK(db_->GetPartial(TitanReadOptions(), key, range[0], range[1],
+                                &value));
+      uint64_t begin = std::min<uint64_t>(range[0], expected.size());
+      ASSERT_EQ(expected.substr(begin, range[1]), value.ToString());
+    }
+  };
+  // Not cached, only the requested bytes are read.
+  check("blob", blob_value);
+  check("inline", inline_value);
+  PinnableSlice value;
+  TitanReadOptions no_io;
+  no_io.read_tier = kBlockCacheTier;
+  ASSERT_TRUE(db_->GetPartial(no_io, "blob", 0, 10, &value).IsIncomplete());
+
+  // Served from the cached record.
+  std::string full;
+  ASSERT_OK(db_->Get(ReadOptions(), "blob", &full));
+  ASSERT_EQ(blob_value, full);
+  ASSERT_OK(db_->GetPartial(no_io, "blob", 7, 100, &value));
+  ASSERT_EQ(blob_value.substr(7, 100), value.ToString());
+  check("blob", blob_value);
+
+  ASSERT_TRUE(db_->GetPartial(TitanReadOptions(), "missing", 0, 1, &value)
+                  .IsNotFound());
+}
+
+TEST_F(TitanDBTest, ValueSizeWithoutBlobRead) {
+  options_.blob_file_compression = kNoCompression;
+  Open();
+  std::map<std::string, std::string> data;
+  Put(1, &data);
+  Put(2, &data);
+  Flush();
+  options_.compact_blob_index = true;
+  Reopen();
+  Put(3, &data);
+  Put(4, &data);
+  Flush();
+
+  for (uint64_t k = 1; k <= 4; k++) {
+    std::string key = GenKey(k);
+    uint64_t size = 0;
+    ASSERT_OK(db_->GetValueSize(TitanReadOptions(), key, &size));
+    if (k == 1) {
+      // Legacy blob index, the stored record is a bit larger than the value.
+      ASSERT_GT(size, data[key].size());
+    } else {
+      ASSERT_EQ(data[key].size(), size);
+    }
+    std::string value;
+    bool value_found = false;
+    ASSERT_TRUE(db_->KeyMayExist(ReadOptions(), key, &value, &value_found));
+    if (data[key].size() < options_.min_blob_size) {
+      ASSERT_TRUE(value_found);
+      ASSERT_EQ(data[key], value);
+    } else {
+      // No blob cache to serve the value from.
+      ASSERT_FALSE(value_found);
+    }
+  }
+  uint64_t size = 0;
+  ASSERT_TRUE(
+      db_->GetValueSize(TitanReadOptions(), GenKey(5), &size).IsNotFound());
+  ASSERT_FALSE(db_->KeyMayExist(ReadOptions(), GenKey(5), nullptr));
+
+  TitanReadOptions ro;
+  ro.value_size_only = true;
+  std::unique_ptr<Iterator> iter(db_->NewIterator(ro));
+  uint64_t k = 1;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next(), k++) {
+    std::string key = GenKey(k);
+    ASSERT_EQ(key, iter->key());
+    std::string prop;
+    ASSERT_OK(
+        iter->GetProperty(TitanDB::Properties::kIteratorValueSize, &prop));
+    uint64_t expected = 0;
+    ASSERT_OK(db_->GetValueSize(TitanReadOptions(), key, &expected));
+    ASSERT_EQ(ToString(expected), prop);
+  }
+  ASSERT_OK(iter->status());
+  ASSERT_EQ(5, k);
+}
+
+TEST_F(TitanDBTest, BlobCacheWarmUp) {
+  const uint64_t kNumKeys = 100;
+  // Values of even keys are kept inline.
+  const uint64_t kNumBlobs = kNumKeys / 2;
+  std::map<std::string, std::string> data;
+  options_.blob_cache = NewLRUCache(1 << 20);
+  options_.blob_cache_dump_period_sec = 3600;
+  options_.blob_cache_warmup_bytes_per_sec = 0;
+  Open();
+  for (uint64_t i = 0; i < kNumKeys; i++) {
+    Put(i, &data);
+  }
+  Flush();
+  VerifyDB(data);
+  // Dumps the hot blobs on close.
+  Close();
+
+  options_.blob_cache = NewLRUCache(1 << 20);
+  Open();
+  // Waits for the warm-up in the background.
+  for (int i = 0; i < 1000; i++) {
+    if (GetTickerCount(TitanStats::BLOB_CACHE_WARMUP_RECORDS) == kNumBlobs) {
+      break;
+    }
+    env_->SleepForMicroseconds(10 * 1000);
+  }
+  ASSERT_EQ(kNumBlobs, GetTickerCount(TitanStats::BLOB_CACHE_WARMUP_RECORDS));
+  ASSERT_EQ(0U, GetTickerCount(TitanStats::BLOB_CACHE_WARMUP_SKIPPED));
+  ASSERT_GT(options_.blob_cache->GetUsage(), 0U);
+  uint64_t misses = GetTickerCount(TitanStats::BLOB_CACHE_MISS);
+  VerifyDB(data);
+  ASSERT_EQ(misses, GetTickerCount(TitanStats::BLOB_CACHE_MISS));
+}
+
+TEST_F(TitanDBTest, BlobCacheWarmUpRateLimit) {
+  std::map<std::string, std::string> data;
+  options_.blob_cache = NewLRUCache(1 << 20);
+  options_.blob_cache_dump_period_sec = 3600;
+  Open();
+  for (uint64_t i = 0; i < 100; i++) {
+    Put(i, &data);
+  }
+  Flush();
+  VerifyDB(data);
+  Close();
+
+  // The reads of the warm-up are charged to its rate limiter.
+  std::atomic<int64_t> limited_bytes{0};
+  SyncPoint::GetInstance()->SetCallBack(
+      "BlobFileSet::WarmUpBlobCache:Limited", [&](void* arg) {
+        auto* limiter = reinterpret_cast<RateLimiter*>(arg);
+        limited_bytes.store(limiter->GetTotalBytesThrough());
+      });
+  SyncPoint::GetInstance()->EnableProcessing();
+  options_.blob_cache = NewLRUCache(1 << 20);
+  Open();
+  for (int i = 0; i < 1000; i++) {
+    if (GetTickerCount(TitanStats::BLOB_CACHE_WARMUP_RECORDS) > 0) {
+      break;
+    }
+    env_->SleepForMicroseconds(10 * 1000);
+  }
+  ASSERT_GT(GetTickerCount(TitanStats::BLOB_CACHE_WARMUP_RECORDS), 0U);
+  Close();
+  SyncPoint::GetInstance()->DisableProcessing();
+  SyncPoint::GetInstance()->ClearAllCallBacks();
+  ASSERT_GT(limited_bytes.load(), 0);
+}
+
+TEST_F(TitanDBTest, TitanRowCache) {
+  options_.titan_row_cache = NewLRUCache(1 << 20);
+  Open();
+  std::map<std::string, std::string> data;
+  for (uint64_t i = 0; i < 10; i++) {
+    Put(i, &data);
+  }
+  Flush();
+  VerifyDB(data);
+  uint64_t hits = GetTickerCount(TitanStats::TITAN_ROW_CACHE_HIT);
+  std::string value;
+  ASSERT_OK(db_->Get(ReadOptions(), GenKey(1), &value));
+  ASSERT_EQ(data[GenKey(1)], value);
+  ASSERT_EQ(hits + 1, GetTickerCount(TitanStats::TITAN_ROW_CACHE_HIT));
+
+  // Writes of every kind invalidate the cached values.
+  ASSERT_OK(db_->Put(WriteOptions(), GenKey(1), "new value"));
+  ASSERT_OK(db_->Get(ReadOptions(), GenKey(1), &value));
+  ASSERT_EQ("new value", value);
+  WriteBatch batch;
+  ASSERT_OK(batch.Put(GenKey(1), "batch value"));
+  ASSERT_OK(batch.Delete(GenKey(2)));
+  ASSERT_OK(db_->Write(WriteOptions(), &batch));
+  ASSERT_OK(db_->Get(ReadOptions(), GenKey(1), &value));
+  ASSERT_EQ("batch value", value);
+  ASSERT_TRUE(db_->Get(ReadOptions(), GenKey(2), &value).IsNotFound());
+  ASSERT_OK(db_->Delete(WriteOptions(), GenKey(3)));
+  ASSERT_TRUE(db_->Get(ReadOptions(), GenKey(3), &value).IsNotFound());
+  ASSERT_OK(db_->DeleteRange(WriteOptions(), db_->DefaultColumnFamily(),
+                             GenKey(4), GenKey(6)));
+  ASSERT_TRUE(db_->Get(ReadOptions(), GenKey(4), &value).IsNotFound());
+  ASSERT_TRUE(db_->Get(ReadOptions(), GenKey(5), &value).IsNotFound());
+  ASSERT_OK(db_->Get(ReadOptions(), GenKey(6), &value));
+  ASSERT_EQ(data[GenKey(6)], value);
+}
+
+TEST_F(TitanDBTest, InlineHotValues) {
+  options_.hot_value_inline_budget = 1 << 20;
+  options_.hot_value_sample_rate = 1;
+  Open();
+  std::map<std::string, std::string> data;
+  for (uint64_t i = 0; i < 10; i++) {
+    Put(i, &data);
+  }
+  Flush();
+  // Only key 1 is read often enough to become hot.
+  std::string value;
+  for (int i = 0; i < 8; i++) {
+    ASSERT_OK(db_->Get(ReadOptions(), GenKey(1), &value));
+  }
+  ASSERT_OK(db_->Get(ReadOptions(), GenKey(3), &value));
+  CompactAll();
+  ASSERT_EQ(1U, GetTickerCount(TitanStats::HOT_VALUE_INLINED));
+  VerifyDB(data);
+
+  // Rewritten hot values stay inline.
+  Put(1, &data);
+  Flush();
+  ASSERT_GE(GetTickerCount(TitanStats::HOT_VALUE_KEPT_INLINE), 1U);
+  VerifyDB(data);
+}
+
+TEST_F(TitanDBTest, ChunkedValues) {
+  options_.blob_chunk_size = 100;
+  options_.chunked_value_min_size = 1000;
+  Open();
+  std::string value;
+  for (int i = 0; i < 1050; i++) {
+    value.push_back(static_cast<char>('a' + i % 26));
+  }
+  std::string source_path = dbname_ + "/stream_source";
+  ASSERT_OK(WriteStringToFile(env_, value, source_path));
+  std::unique_ptr<SequentialFile> source;
+  ASSERT_OK(env_->NewSequentialFile(source_path, &source, EnvOptions()));
+  ASSERT_OK(db_->PutStream(WriteOptions(), "streamed", source.get()));
+  ASSERT_OK(db_->Put(WriteOptions(), "put", value));
+  ASSERT_OK(db_->Put(WriteOptions(), "small", "small"));
+
+  auto read_stream = [&](SequentialFile* stream, std::string* result) {
+    result->clear();
+    char scratch[64];
+    Slice fragment;
+    do {
+      ASSERT_OK(stream->Read(sizeof(scratch), &fragment, scratch));
+      result->append(fragment.data(), fragment.size());
+    } while (!fragment.empty());
+  };
+  auto check = [&](const std::string& key) {
+    std::string result;
+    ASSERT_OK(db_->Get(ReadOptions(), key, &result));
+    ASSERT_EQ(value, result);
+    PinnableSlice partial;
+    ASSERT_OK(db_->GetPartial(TitanReadOptions(), key, 150, 300, &partial));
+    ASSERT_EQ(value.substr(150, 300), partial.ToString());
+    ASSERT_OK(db_->GetPartial(TitanReadOptions(), key, 1040, 100, &partial));
+    ASSERT_EQ(value.substr(1040), partial.ToString());
+
+    std::unique_ptr<SequentialFile> stream;
+    ASSERT_OK(db_->GetStream(TitanReadOptions(), key, &stream));
+    ASSERT_OK(stream->Skip(10));
+    read_stream(stream.get(), &result);
+    ASSERT_EQ(value.substr(10), result);
+  };
+  check("streamed");
+  check("put");
+  std::unique_ptr<SequentialFile> stream;
+  ASSERT_OK(db_->GetStream(TitanReadOptions(), "small", &stream));
+  std::string result;
+  read_stream(stream.get(), &result);
+  ASSERT_EQ("small", result);
+  stream.reset();
+
+  Flush();
+  CompactAll();
+  Reopen();
+  check("streamed");
+  check("put");
+
+  std::unique_ptr<Iterator> iter(db_->NewIterator(ReadOptions()));
+  iter->Seek("put");
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ(value, iter->value().ToString());
+  std::vector<std::string> values;
+  std::vector<Status> statuses =
+      db_->MultiGet(ReadOptions(), {db_->DefaultColumnFamily()},
+                    {Slice("streamed")}, &values);
+  ASSERT_OK(statuses[0]);
+  ASSERT_EQ(value, values[0]);
+  iter.reset();
+
+  // Chunks of live values are left alone by GC.
+  CallGC();
+  check("streamed");
+
+  // A stream keeps reading the value it was opened on.
+  ASSERT_OK(db_->GetStream(TitanReadOptions(), "streamed", &stream));
+  ASSERT_OK(db_->Put(WriteOptions(), "streamed", "overwritten"));
+  read_stream(stream.get(), &result);
+  ASSERT_EQ(value, result);
+  stream.reset();
+  ASSERT_OK(db_->Get(ReadOptions(), "streamed", &result));
+  ASSERT_EQ("overwritten", result);
+}
+
 }  // namespace titandb
 }  // namespace rocksdb
 
@@ -24,6 +24,7 @@ static const std::string num_discardable_ratio_le80_file =
     "num-discardable-ratio-le80-file";
 static const std::string num_discardable_ratio_le100_file =
     "num-discardable-ratio-le100-file";
+static const std::string iterator_value_size = "iterator.value-size";
 
 const std::string TitanDB::Properties::kLiveBlobSize =
     titandb_prefix + live_blob_size;
@@ -45,6 +46,8 @@ const std::string TitanDB::Properties::kNumDiscardableRatioLE80File =
     titandb_prefix + num_discardable_ratio_le80_file;
 const std::string TitanDB::Properties::kNumDiscardableRatioLE100File =
     titandb_prefix + num_discardable_ratio_le100_file;
+const std::string TitanDB::Properties::kIteratorValueSize =
+    titandb_prefix + iterator_value_size;
 
 const std::unordered_map<std::string, TitanInternalStats::StatsType>
     TitanInternalStats::stats_type_string_map = {
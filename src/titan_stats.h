@@ -138,7 +138,33 @@ class TitanStats : public Statistics {
  public:
   enum TickerType : uint32_t {
     BLOB_CACHE_HIT = TICKER_ENUM_MAX + 1,
+    // Blob cache lookups missing both the blob cache and the compressed
+    // blob cache, see TitanCFOptions::blob_compressed_cache.
     BLOB_CACHE_MISS,
+    // Blob cache lookups served by the compressed blob cache.
+    BLOB_COMPRESSED_CACHE_HIT,
+    // Lookups of the flash cache, see TitanDBOptions::blob_flash_cache_path,
+    // made after missing the blob cache.
+    BLOB_FLASH_CACHE_HIT,
+    BLOB_FLASH_CACHE_MISS,
+    // Records read from blob files kept out of the blob cache by
+    // TitanCFOptions::blob_cache_admission.
+    BLOB_CACHE_ADMISSION_REJECT,
+    // Progress of loading the blob cache on open, see
+    // TitanDBOptions::blob_cache_dump_period_sec: records loaded, their
+    // bytes, and records skipped as their file is gone or unreadable.
+    BLOB_CACHE_WARMUP_RECORDS,
+    BLOB_CACHE_WARMUP_BYTES,
+    BLOB_CACHE_WARMUP_SKIPPED,
+    // Lookups of TitanDBOptions::titan_row_cache by Get. Stale entries
+    // count as misses.
+    TITAN_ROW_CACHE_HIT,
+    TITAN_ROW_CACHE_MISS,
+    // Hot values inlined into SSTs by compaction, and hot values kept
+    // inline rather than separated, see
+    // TitanCFOptions::hot_value_inline_budget.
+    HOT_VALUE_INLINED,
+    HOT_VALUE_KEPT_INLINE,
 
     GC_NO_NEED,
     GC_REMAIN,
@@ -151,6 +177,17 @@ class TitanStats : public Statistics {
     GC_SUCCESS,
     GC_TRIGGER_NEXT,
 
+    BLOB_CHECKSUM_VERIFIED,
+    BLOB_CHECKSUM_MISMATCH,
+    // Time spent verifying blob record checksums.
+    BLOB_CHECKSUM_VERIFY_NANOS,
+
+    // Bytes asked for by direct blob reads, and bytes actually read after
+    // rounding to sector boundaries. Their ratio is the read amplification
+    // of alignment.
+    BLOB_DIRECT_READ_BYTES,
+    BLOB_DIRECT_READ_ALIGNED_BYTES,
+
     INTERNAL_TICKER_ENUM_MAX,
   };
 
@@ -1,5 +1,8 @@
 #include "util.h"
 
+#include <algorithm>
+
+#include "util/random.h"
 #include "util/stop_watch.h"
 
 namespace rocksdb {
@@ -166,5 +169,69 @@ Status SyncTitanManifest(Env* env, TitanStats* stats,
   return file->Sync(db_options->use_fsync);
 }
 
+Status CheckReadDeadline(Env* env, const TitanReadOptions& options) {
+  if (options.deadline > 0 && env->NowMicros() >= options.deadline) {
+    return Status::TimedOut("blob read deadline exceeded");
+  }
+  return Status::OK();
+}
+
+void PinPartialValue(const Slice& data, uint64_t offset, uint64_t len,
+                     PinnableSlice* buffer, PinnableSlice* value) {
+  uint64_t begin = std::min<uint64_t>(offset, data.size());
+  uint64_t size = std::min<uint64_t>(len, data.size() - begin);
+  Slice range(data.data() + begin, static_cast<size_t>(size));
+  value->Reset();
+  if (buffer->IsPinned()) {
+    value->PinSlice(range, buffer);
+  } else {
+    value->PinSelf(range);
+  }
+}
+
+bool ShouldVerifyBlobChecksum(const TitanCFOptions& options,
+                              bool for_compaction) {
+  switch (options.blob_checksum_policy) {
+    case TitanBlobChecksumPolicy::kOnRead:
+      return true;
+    case TitanBlobChecksumPolicy::kOnGC:
+      return for_compaction;
+    case TitanBlobChecksumPolicy::kSampled:
+      return for_compaction ||
+             Random::GetTLSInstance()->OneIn(static_cast<int>(
+                 std::max(options.blob_checksum_sample_interval, 1u)));
+    default:
+      return false;
+  }
+}
+
+void AlignedBufferPool::Acquire(size_t alignment, size_t size,
+                                AlignedBuffer* buffer) {
+  {
+    MutexLock l(&mutex_);
+    auto it = buffers_.lower_bound(size);
+    // Don't hand out buffers much larger than asked for, they would be
+    // lost for the reads they fit better.
+    if (it != buffers_.end() && it->first <= size * 2 &&
+        it->second.Alignment() == alignment) {
+      pooled_bytes_ -= it->first;
+      *buffer = std::move(it->second);
+      buffers_.erase(it);
+      return;
+    }
+  }
+  buffer->Alignment(alignment);
+  buffer->AllocateNewBuffer(size);
+}
+
+void AlignedBufferPool::Release(AlignedBuffer buffer) {
+  size_t capacity = buffer.Capacity();
+  MutexLock l(&mutex_);
+  if (pooled_bytes_ + capacity <= capacity_) {
+    pooled_bytes_ += capacity;
+    buffers_.emplace(capacity, std::move(buffer));
+  }
+}
+
 }  // namespace titandb
 }  // namespace rocksdb
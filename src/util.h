@@ -2,10 +2,12 @@
 
 #include "options/db_options.h"
 #include "rocksdb/cache.h"
+#include "util/aligned_buffer.h"
 #include "util/compression.h"
 #include "util/file_reader_writer.h"
 
 #include <list>
+#include <map>
 #include "titan_stats.h"
 
 namespace rocksdb {
@@ -59,6 +61,9 @@ class OwnedSlice : public Slice {
     buffer_ = std::move(buffer);
   }
 
+  // Returns true if the data is held in a buffer of this slice.
+  bool owned() const { return buffer_ != nullptr; }
+
   char* release() {
     data_ = nullptr;
     size_ = 0;
@@ -85,6 +90,27 @@ class FixedSlice : public Slice {
   char buffer_[T];
 };
 
+// Aligned buffers reused by direct reads. At most "capacity" bytes of
+// idle buffers are kept, anything beyond is freed when given back.
+class AlignedBufferPool {
+ public:
+  explicit AlignedBufferPool(size_t capacity) : capacity_(capacity) {}
+
+  // Sets "*buffer" to a buffer aligned to "alignment" with room for at
+  // least "size" bytes.
+  void Acquire(size_t alignment, size_t size, AlignedBuffer* buffer);
+
+  // Gives a buffer obtained from Acquire back to the pool.
+  void Release(AlignedBuffer buffer);
+
+ private:
+  const size_t capacity_;
+  port::Mutex mutex_;
+  // Idle buffers by capacity.
+  std::multimap<size_t, AlignedBuffer> buffers_;
+  size_t pooled_bytes_{0};
+};
+
 // Compresses the input data according to the compression context.
 // Returns a slice with the output data and sets "*type" to the output
 // compression type.
@@ -113,5 +139,21 @@ Status SyncTitanManifest(Env* env, TitanStats* stats,
                          const ImmutableDBOptions* db_options,
                          WritableFileWriter* file);
 
+// Returns TimedOut if the deadline of the read has passed, see
+// TitanReadOptions::deadline.
+Status CheckReadDeadline(Env* env, const TitanReadOptions& options);
+
+// Pins up to "len" bytes of "data" starting at "offset" into "value",
+// stopping at the end of "data", which lives in "buffer". Pinned memory
+// of "buffer" is handed over to "value", anything else is copied.
+void PinPartialValue(const Slice& data, uint64_t offset, uint64_t len,
+                     PinnableSlice* buffer, PinnableSlice* value);
+
+// Returns whether a blob record read from a blob file should have its
+// checksum verified, see TitanCFOptions::blob_checksum_policy.
+// "for_compaction" reads are those of GC and level merge.
+bool ShouldVerifyBlobChecksum(const TitanCFOptions& options,
+                              bool for_compaction);
+
 }  // namespace titandb
 }  // namespace rocksdb
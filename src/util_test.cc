@@ -30,6 +30,28 @@ TEST(UtilTest, Compression) {
   }
 }
 
+TEST(UtilTest, AlignedBufferPool) {
+  AlignedBufferPool pool(8192);
+  AlignedBuffer buffer;
+  pool.Acquire(512, 1000, &buffer);
+  ASSERT_EQ(buffer.Alignment(), 512u);
+  ASSERT_GE(buffer.Capacity(), 1000u);
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(buffer.BufferStart()) % 512, 0u);
+  char* start = buffer.BufferStart();
+  pool.Release(std::move(buffer));
+
+  // A pooled buffer is reused by a read of a similar size.
+  AlignedBuffer reused;
+  pool.Acquire(512, 800, &reused);
+  ASSERT_EQ(reused.BufferStart(), start);
+
+  // But not by a much smaller one.
+  pool.Release(std::move(reused));
+  AlignedBuffer small;
+  pool.Acquire(512, 100, &small);
+  ASSERT_NE(small.BufferStart(), start);
+}
+
 }  // namespace titandb
 }  // namespace rocksdb
 